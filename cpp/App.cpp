@@ -1,12 +1,19 @@
 
 #include "App.hpp"
 
+#include <bit>
 #include <charconv>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <optional>
+#include <queue>
+#include <unordered_set>
 #include <vector>
 
+#include "Corpus.hpp"
+#include "Packer.hpp"
 #include "Player.hpp"
 #include "Solver.hpp"
 
@@ -14,6 +21,7 @@
 
 
 App::App(Args && args) :
+	solverConfig_(args.solverConfig),
 	moobaa_([&args] () -> Moobaa {
 		if (args.moobaa) {
 			return Moobaa::load();
@@ -21,6 +29,7 @@ App::App(Args && args) :
 			return {};
 		}
 	}()),
+	mapFilePath_(args.mapFilePath),
 	map_([&args, this] () -> Map {
 		if (!args.mapFilePath.empty()) {
 			return loader_.load(args.mapFilePath);
@@ -38,19 +47,139 @@ App::App(Args && args) :
 	}
 
 	if (!map_.info.shortName.empty()) {
-		loader_.draw(map_);
-		_execMap();
+		if (!args.levelHeaderPath.empty()) {
+			_execLevelHeader(args.levelHeaderPath);
+		} else {
+			loader_.draw(map_);
+			_execMap();
+		}
 	}
 
 	if (args.convert) {
 		_execConvert();
 	}
+
+	if (args.hashStats) {
+		_execHashStats();
+	}
+
+	if (args.playerBench) {
+		_execPlayerBench();
+	}
+
+	if (args.searchStats) {
+		_execSearchStats();
+	}
 }
 
 
 void App::_execMap() noexcept
 {
-	Solver::solve(map_, [] (Solver::Solution &&) {});
+	Solver::Config config = solverConfig_;
+
+	std::optional<PatternDatabase> patternDatabase;
+	const bool estimates = config.search == Solver::Search::AStar || config.search == Solver::Search::Beam ||
+			config.search == Solver::Search::WeightedAStar || config.search == Solver::Search::IdaStar;
+	if (estimates && PatternDatabase::covers(map_)) {
+		patternDatabase.emplace(map_, PatternDatabase::cachePathFor(mapFilePath_));
+		if (patternDatabase->loaded()) {
+			printf("pattern database: loaded\n");
+		} else {
+			printf("pattern database: built in %.3fs\n", patternDatabase->buildSeconds());
+		}
+		config.patternDatabase = &*patternDatabase;
+	}
+
+	Solver::solve(map_, config, [] (Solver::Solution &&) {});
+}
+
+
+void App::_execLevelHeader(const std::filesystem::path & path) noexcept
+{
+	// the tables buildIndex() made of the map, for a binary built for it to compile in; see FixedMap
+	std::ofstream file(path);
+	assert(file.good());
+
+	const auto hex = [] (const int value, const int digits) -> std::string {
+		char s[16];
+		snprintf(s, sizeof(s), "0x%0*x", digits, value);
+		return s;
+	};
+
+	const auto writePos = [&file] (const Pos & pos) {
+		file << "{" << int(pos.x) << ", " << int(pos.y) << "}";
+	};
+
+	// the elements of an array, one per line, or nothing at all
+	const auto writeArray = [&file] (const std::string_view & type, const std::string_view & name, const int size,
+			const std::function<void(int index)> & writeElement) {
+		file << "\tstatic constexpr std::array<" << type << ", " << size << "> " << name << " = {";
+		if (size != 0) {
+			file << "{\n";
+			for (int i = 0; i < size; ++i) {
+				file << "\t\t";
+				writeElement(i);
+				file << ",\n";
+			}
+			file << "\t}";
+		}
+		file << "};\n";
+	};
+
+	std::string shortName;
+	for (const char c : map_.info.shortName) {
+		if (c == '"' || c == '\\') shortName += '\\';
+		shortName += c;
+	}
+
+	file << "\n// Generated by slayawaycamp -H from " << map_.info.shortName << ", do not edit.\n";
+	file << "\n#pragma once\n";
+	file << "\n#include \"FixedMap.hpp\"\n";
+	file << "\n\n\n\nstruct GeneratedLevel {\n";
+	file << "\tstatic constexpr std::string_view kShortName = \"" << shortName << "\";\n";
+	file << "\tstatic constexpr uint16_t kMechanics = " << hex(map_.mechanics, 3) << ";\n";
+	file << "\tstatic constexpr int kWidth = " << map_.width << ";\n";
+	file << "\tstatic constexpr int kHeight = " << map_.height << ";\n";
+	file << "\tstatic constexpr Portal kPortal = {";
+	writePos(map_.portal.pos);
+	file << "};\n";
+
+	writeArray("Map::Cell", "kCells", map_.cells.size(), [this, &file, &hex] (const int index) {
+		const Map::Cell & cell = map_.cells[index];
+		file << "{.walls = " << hex(cell.walls, 4) << ", .tallWalls = " << hex(cell.tallWalls, 1) <<
+				", .flags = " << hex(cell.flags, 2) << ", .phoneColor = " << int(cell.phoneColor) <<
+				", .teleportColor = " << int(cell.teleportColor) << ", .otherTeleport = " << cell.otherTeleport <<
+				", .slideLengths = {";
+		for (int i = 0; i < int(cell.slideLengths.size()); ++i) {
+			file << (i == 0 ? "" : ", ") << int(cell.slideLengths[i]);
+		}
+		file << "}}";
+	});
+
+	writeArray("Phone", "kPhones", map_.phones.size(), [this, &file, &writePos] (const int index) {
+		const Phone & phone = map_.phones[index];
+		file << "{.pos = ";
+		writePos(phone.pos);
+		file << ", .color = Color(" << int(phone.color) << ")}";
+	});
+
+	writeArray("std::array<Map::PhoneLine, 4>", "kPhoneLines", map_.phoneLines.size(), [this, &file] (const int index) {
+		file << "{{";
+		for (const Map::PhoneLine & line : map_.phoneLines[index]) {
+			file << (&line == map_.phoneLines[index].data() ? "" : ", ") <<
+					"{.begin = " << line.begin << ", .end = " << line.end << "}";
+		}
+		file << "}}";
+	});
+
+	writeArray("Pos", "kPhoneLineCells", map_.phoneLineCells.size(), [this, &writePos] (const int index) {
+		writePos(map_.phoneLineCells[index]);
+	});
+
+	file << "};\n";
+
+	assert(file.good());
+	printf("level header: %s\n", path.c_str());
 }
 
 
@@ -213,9 +342,9 @@ void App::_execMoobaa() noexcept
 
 			const Map map = loader_.load(seriesPath / serie.filename);
 
-			serie.bestSteps = [&map] () -> Steps {
+			serie.bestSteps = [this, &map] () -> Steps {
 				Solver::Solution best;
-				Solver::solve(map, [&best] (Solver::Solution && solution) {
+				Solver::solve(map, solverConfig_, [&best] (Solver::Solution && solution) {
 					if (best.steps.empty() || solution.steps.size() < best.steps.size()) {
 						best = std::move(solution);
 					}
@@ -355,11 +484,366 @@ void App::_execMoobaa() noexcept
 
 void App::_execConvert() noexcept
 {
-	for (const std::filesystem::directory_entry & entry :
-			std::filesystem::recursive_directory_iterator(SLAYAWAYCAMP_MOVIES_DIR)) {
-		if (entry.is_regular_file() && entry.path().extension() == kSerieExtension) {
-			const Map map = loader_.load(entry.path());
-			loader_.save(entry.path(), map);
+	for (const std::filesystem::path & path : corpusPaths(SLAYAWAYCAMP_MOVIES_DIR)) {
+		const Map map = loader_.load(path);
+		loader_.save(path, map);
+	}
+}
+
+
+void App::_execHashStats() noexcept
+{
+	// compares the bucket chains each state hash produces over every reachable state of the corpus
+
+	struct Hasher {
+		std::string_view name;
+		std::function<std::size_t(const State & state)> hash;
+	};
+
+	const std::vector<Hasher> hashers = {
+		{
+			.name = "legacy",
+			.hash = [] (const State & state) -> std::size_t {
+				// the former xor-shift fold over identity hashes
+				std::size_t sum = 0;
+				int index = 0;
+				const auto add = [&sum, &index] (const std::size_t v) {
+					sum ^= v << index;
+					index++;
+					if (index == sizeof(sum)) index = 0;
+				};
+				const auto addPos = [&add] (const Pos & pos) {
+					add(std::size_t(pos.x) ^ std::size_t(pos.y));
+				};
+				addPos(state.killer.pos);
+				for (const Dude & dude : state.dudes) {
+					add(std::size_t(dude.type));
+					addPos(dude.pos);
+					if (dude.type == Dude::Type::Cop || dude.type == Dude::Type::Swat) {
+						add(std::size_t(dude.dir));
+					}
+					if (dude.type == Dude::Type::Drop) {
+						add(std::size_t(dude.orientation));
+					}
+				}
+				for (const Mine & mine : state.mines) {
+					addPos(mine.pos);
+				}
+				add(state.light);
+				return sum;
+			},
+		},
+		{
+			.name = "mixer",
+			.hash = [] (const State & state) -> std::size_t {
+				return state.calculateHash();
+			},
+		},
+		{
+			.name = "zobrist",
+			.hash = [] (const State & state) -> std::size_t {
+				return state.key;
+			},
+		},
+	};
+
+	struct Chains {
+		int64_t probes = 0;
+		int maxLength = 0;
+
+		void add(std::vector<int> & lengths, const std::size_t bucket) noexcept
+		{
+			const int length = ++lengths[bucket];
+			probes += length;
+			maxLength = std::max(maxLength, length);
+		}
+	};
+
+	struct Stats {
+		int64_t stateCount = 0;
+		int64_t collisionCount = 0;
+		Chains primeChains;
+		Chains pow2Chains;
+	};
+
+	std::vector<Stats> totals(hashers.size());
+
+	const std::vector<std::filesystem::path> paths = corpusPaths(SLAYAWAYCAMP_MOVIES_DIR);
+
+	const auto printStats = [&hashers] (const std::vector<Stats> & stats) {
+		for (int i = 0; i < int(hashers.size()); ++i) {
+			const Stats & s = stats[i];
+			printf("hash:     %-8s collisions: %6lld  prime: avg %.3f max %3d  pow2: avg %.3f max %3d\n",
+					hashers[i].name.data(), (long long)s.collisionCount,
+					double(s.primeChains.probes) / std::max<int64_t>(1, s.stateCount), s.primeChains.maxLength,
+					double(s.pow2Chains.probes) / std::max<int64_t>(1, s.stateCount), s.pow2Chains.maxLength);
+		}
+	};
+
+	for (const std::filesystem::path & path : paths) {
+		const Map map = loader_.load(path);
+
+		const std::unordered_set<State> states = reachableStates(map, map.state);
+
+		const std::size_t primeBucketCount = states.bucket_count();
+		const std::size_t pow2BucketCount = std::bit_ceil(states.size());
+
+		std::vector<Stats> stats(hashers.size());
+
+		for (int i = 0; i < int(hashers.size()); ++i) {
+			Stats & s = stats[i];
+			std::vector<int> primeLengths(primeBucketCount);
+			std::vector<int> pow2Lengths(pow2BucketCount);
+			std::unordered_set<std::size_t> hashes;
+			for (const State & state : states) {
+				const std::size_t hash = hashers[i].hash(state);
+				s.stateCount++;
+				if (!hashes.insert(hash).second) {
+					s.collisionCount++;
+				}
+				s.primeChains.add(primeLengths, hash % primeBucketCount);
+				s.pow2Chains.add(pow2Lengths, hash & (pow2BucketCount - 1));
+			}
+
+			Stats & total = totals[i];
+			total.stateCount += s.stateCount;
+			total.collisionCount += s.collisionCount;
+			total.primeChains.probes += s.primeChains.probes;
+			total.primeChains.maxLength = std::max(total.primeChains.maxLength, s.primeChains.maxLength);
+			total.pow2Chains.probes += s.pow2Chains.probes;
+			total.pow2Chains.maxLength = std::max(total.pow2Chains.maxLength, s.pow2Chains.maxLength);
+		}
+
+		printf("hash: %s states: %d\n", path.filename().c_str(), int(states.size()));
+		printStats(stats);
+	}
+
+	printf("hash: total levels: %d states: %lld\n", int(paths.size()), (long long)totals.front().stateCount);
+	printStats(totals);
+}
+
+
+// plays every direction from every state in place, appending the outcomes when asked to
+template <uint16_t kMechanics>
+static void playStates(const Map & map, const std::vector<State> & states, std::vector<uint64_t> * const outcomes)
+{
+	// one working state reloaded for every state, as the solver does
+	WorkingState working;
+	UndoLog undoLog;
+	for (const State & state : states) {
+		working.load(state);
+		for (const Dir dir : kAllDirs) {
+			const Player::Result result = BasicPlayer<kMechanics>::apply(map, working, dir, undoLog);
+			if (outcomes) {
+				outcomes->push_back(result == Player::Result::Fail ? 0 : working.key() ^ uint64_t(result));
+			}
+			BasicPlayer<kMechanics>::undo(working, undoLog);
+		}
+	}
+}
+
+
+void App::_execPlayerBench() noexcept
+{
+	// times the generic and the specialized player over every reachable state of the corpus
+
+	static constexpr int kRoundCount = 5;
+
+	const std::vector<std::filesystem::path> paths = corpusPaths(SLAYAWAYCAMP_MOVIES_DIR);
+
+	const auto timeRounds = [] (const std::function<void()> & play) -> double {
+		const auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < kRoundCount; ++round) {
+			play();
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	int64_t totalStepCount = 0;
+	int mismatchCount = 0;
+	double totalGenericTime = 0;
+	double totalSpecializedTime = 0;
+
+	for (const std::filesystem::path & path : paths) {
+		const Map map = loader_.load(path);
+
+		const std::unordered_set<State> reachable = reachableStates(map, map.state);
+		const std::vector<State> states(reachable.begin(), reachable.end());
+
+		uint16_t specializedMechanics = 0;
+		std::vector<uint64_t> genericOutcomes;
+		std::vector<uint64_t> specializedOutcomes;
+		double genericTime = 0;
+		double specializedTime = 0;
+
+		playStates<Mechanics::kAll>(map, states, &genericOutcomes);
+		genericTime = timeRounds([&map, &states] { playStates<Mechanics::kAll>(map, states, nullptr); });
+
+		withPlayerMechanics(map.mechanics, [&] <uint16_t kMechanics> () {
+			specializedMechanics = kMechanics;
+			playStates<kMechanics>(map, states, &specializedOutcomes);
+			specializedTime = timeRounds([&map, &states] { playStates<kMechanics>(map, states, nullptr); });
+		});
+
+		const bool same = genericOutcomes == specializedOutcomes;
+		if (!same) {
+			mismatchCount++;
+		}
+
+		printf("bench: %s mechanics: %03x/%03x steps: %d generic: %.3f ms specialized: %.3f ms%s\n",
+				path.filename().c_str(), map.mechanics, specializedMechanics, int(genericOutcomes.size()),
+				genericTime, specializedTime, same ? "" : " MISMATCH");
+
+		totalStepCount += genericOutcomes.size();
+		totalGenericTime += genericTime;
+		totalSpecializedTime += specializedTime;
+	}
+
+	printf("bench: total levels: %d steps: %lld rounds: %d generic: %.3f ms specialized: %.3f ms speedup: %.3f mismatches: %d\n",
+			int(paths.size()), (long long)totalStepCount, kRoundCount, totalGenericTime, totalSpecializedTime,
+			totalGenericTime / std::max(totalSpecializedTime, 1e-9), mismatchCount);
+}
+
+
+void App::_execSearchStats() noexcept
+{
+	// solves every level of the corpus with each search, which have to agree on the shortest win;
+	// the bounded ones, narrowed to show it, only have to bracket it between their lower bound and their win
+
+	const std::vector<std::filesystem::path> paths = corpusPaths(SLAYAWAYCAMP_MOVIES_DIR);
+
+	struct Run {
+		Solver::Search search;
+		std::string_view name;
+		bool patternDatabase = false;
+		bool bounded = false;
+		int threadCount = 0; // overrides -j
+		int64_t expandedCount = 0;
+		int64_t moveCount = 0;
+		int64_t databaseLookupCount = 0;
+		int64_t databaseRaiseCount = 0;
+		double seconds = 0;
+		int shortestCount = 0; // levels a bounded search proved its win the shortest on
+	};
+
+	std::vector<Run> runs = {
+		{.search = Solver::Search::Breadth, .name = "bfs"},
+		{.search = Solver::Search::AStar, .name = "astar"},
+		{.search = Solver::Search::AStar, .name = "astar+pdb", .patternDatabase = true},
+		{.search = Solver::Search::IdaStar, .name = "ida+pdb", .patternDatabase = true},
+		{.search = Solver::Search::Distributed, .name = "hda", .threadCount = 4},
+		{.search = Solver::Search::Frontier, .name = "frontier"},
+		{.search = Solver::Search::Beam, .name = "beam", .patternDatabase = true, .bounded = true},
+		{.search = Solver::Search::WeightedAStar, .name = "wastar", .patternDatabase = true, .bounded = true},
+	};
+	static constexpr int kBoundedStatesPerDepth = 16;
+
+	int mismatchCount = 0;
+	int databaseCount = 0;
+	int loadedDatabaseCount = 0;
+	double databaseSeconds = 0;
+
+	for (const std::filesystem::path & path : paths) {
+		const Map map = loader_.load(path);
+
+		// built once per level, and cached next to it
+		std::optional<PatternDatabase> patternDatabase;
+		if (PatternDatabase::covers(map)) {
+			patternDatabase.emplace(map, PatternDatabase::cachePathFor(path));
+			databaseCount++;
+			loadedDatabaseCount += patternDatabase->loaded() ? 1 : 0;
+			databaseSeconds += patternDatabase->buildSeconds();
+		}
+
+		std::string line;
+		int bestStepCount = -1;
+		bool same = true;
+
+		for (Run & run : runs) {
+			Solver::Config config = solverConfig_;
+			config.search = run.search;
+			config.patternDatabase = run.patternDatabase && patternDatabase ? &*patternDatabase : nullptr;
+			if (run.bounded) {
+				config.statesPerDepth = kBoundedStatesPerDepth;
+			}
+			if (run.threadCount != 0) {
+				config.threadCount = run.threadCount;
+			}
+
+			int stepCount = -1;
+			int lowerBound = 0;
+			bool played = true;
+			const auto start = std::chrono::steady_clock::now();
+			const Solver::Stats stats = Solver::solve(map, config,
+					[&map, &stepCount, &lowerBound, &played] (Solver::Solution && solution) {
+						if (stepCount == -1 || int(solution.steps.size()) < stepCount) {
+							stepCount = solution.steps.size();
+						}
+						lowerBound = std::max(lowerBound, solution.lowerBound);
+
+						// the steps have to win, on the last one only
+						State state = map.state;
+						Player::Result result = Player::Result::None;
+						int playedCount = 0;
+						for (const Dir dir : solution.steps) {
+							if (result != Player::Result::None) break;
+							result = Player::play(map, state, dir);
+							playedCount++;
+						}
+						played = played && result == Player::Result::Win && playedCount == int(solution.steps.size());
+					});
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			same = same && played;
+			if (&run == &runs.front()) {
+				bestStepCount = stepCount;
+			} else if (!run.bounded) {
+				same = same && stepCount == bestStepCount;
+			} else if (bestStepCount == -1) {
+				same = same && stepCount == -1;
+			} else {
+				same = same && lowerBound <= bestStepCount && (stepCount == -1 || stepCount >= bestStepCount);
+				run.shortestCount += stepCount == bestStepCount && lowerBound == stepCount ? 1 : 0;
+			}
+
+			run.expandedCount += stats.expandedCount;
+			run.moveCount += stats.moveCount;
+			run.databaseLookupCount += stats.databaseLookupCount;
+			run.databaseRaiseCount += stats.databaseRaiseCount;
+			run.seconds += seconds;
+
+			char s[128];
+			snprintf(s, sizeof(s), " %s: %d/%d %.3fs", run.name.data(), stats.expandedCount, stats.moveCount, seconds);
+			line += s;
+		}
+
+		if (!same) {
+			mismatchCount++;
+		}
+
+		printf("search: %s steps: %d expanded/stored:%s%s\n", path.filename().c_str(), bestStepCount, line.c_str(),
+				same ? "" : " MISMATCH");
+	}
+
+	for (const Run & run : runs) {
+		printf("search: total %s expanded: %lld (%.3f of bfs) stored: %lld time: %.3fs\n", run.name.data(),
+				(long long)run.expandedCount, double(run.expandedCount) / std::max<int64_t>(1, runs.front().expandedCount),
+				(long long)run.moveCount, run.seconds);
+	}
+	for (const Run & run : runs) {
+		if (run.bounded) {
+			printf("search: %s with %d states per depth proved the shortest win on %d levels\n", run.name.data(),
+					kBoundedStatesPerDepth, run.shortestCount);
+		}
+	}
+	for (const Run & run : runs) {
+		if (run.patternDatabase && !run.bounded) {
+			printf("search: %s pattern database lookups: %lld raised: %lld (%.3f)\n", run.name.data(),
+					(long long)run.databaseLookupCount, (long long)run.databaseRaiseCount,
+					double(run.databaseRaiseCount) / std::max<int64_t>(1, run.databaseLookupCount));
 		}
 	}
+	printf("search: pattern databases: %d loaded: %d build time: %.3fs\n", databaseCount, loadedDatabaseCount,
+			databaseSeconds);
+	printf("search: total levels: %d mismatches: %d\n", int(paths.size()), mismatchCount);
 }
@@ -7,6 +7,7 @@
 #include "Loader.hpp"
 #include "Map.hpp"
 #include "Moobaa.hpp"
+#include "Solver.hpp"
 
 
 
@@ -14,19 +15,30 @@
 class App {
 public:
 	struct Args {
-		std::filesystem::path mapFilePath;
+		std::filesystem::path mapFilePath {};
 		bool moobaa = false;
 		bool convert = false;
+		bool hashStats = false;
+		bool playerBench = false;
+		bool searchStats = false;
+		std::filesystem::path levelHeaderPath {}; // writes the tables of the map instead of solving it
+		Solver::Config solverConfig {};
 	};
 
 	App(Args && args);
 
 private:
 	void _execMap() noexcept;
+	void _execLevelHeader(const std::filesystem::path & path) noexcept;
 	void _execMoobaa() noexcept;
 	void _execConvert() noexcept;
+	void _execHashStats() noexcept;
+	void _execPlayerBench() noexcept;
+	void _execSearchStats() noexcept;
 
+	const Solver::Config solverConfig_;
 	const Loader loader_;
 	const Moobaa moobaa_;
+	const std::filesystem::path mapFilePath_;
 	const Map map_;
 };
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <queue>
 #include <vector>
@@ -36,22 +37,30 @@ enum class Color {
 
 
 
+// A cell, or a shift between cells. Coordinates take a byte each, so that dudes and mines stay small
+// whatever the size of the board.
 struct Pos {
-	int x, y;
+	int8_t x, y;
 
-	static Pos null() noexcept { return { -1, -1 }; }
+	Pos() noexcept = default;
+	constexpr Pos(const int x, const int y) noexcept : x(int8_t(x)), y(int8_t(y))
+	{
+		assert(x >= INT8_MIN && x <= INT8_MAX && y >= INT8_MIN && y <= INT8_MAX);
+	}
+
+	static constexpr Pos null() noexcept { return { -1, -1 }; }
 
-	bool operator==(const Pos & other) const noexcept
+	constexpr bool operator==(const Pos & other) const noexcept
 	{
 		return x == other.x && y == other.y;
 	}
 
-	bool operator!=(const Pos & other) const noexcept
+	constexpr bool operator!=(const Pos & other) const noexcept
 	{
 		return !operator==(other);
 	}
 
-	Pos operator+(const Pos & p) const noexcept
+	constexpr Pos operator+(const Pos & p) const noexcept
 	{
 		return Pos{x + p.x, y + p.y};
 	}
@@ -60,21 +69,38 @@ struct Pos {
 
 
 
+inline uint64_t mixHash(uint64_t x) noexcept
+{
+	// murmur3 finalizer, every input bit affects every output bit
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccd;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53;
+	x ^= x >> 33;
+	return x;
+}
+
+
+inline std::size_t combineHash(const std::size_t seed, const std::size_t value) noexcept
+{
+	return mixHash(seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2)));
+}
+
+
+
+
 template<>
 struct std::hash<Pos> {
 	std::size_t operator()(const Pos & pos) const noexcept
 	{
-		std::size_t hash = 0;
-		hash ^= std::hash<int>{}(pos.x);
-		hash ^= std::hash<int>{}(pos.y);
-		return hash;
+		return mixHash((uint64_t(uint32_t(pos.x)) << 32) | uint32_t(pos.y));
 	}
 };
 
 
 
 
-inline Pos shiftForDir(const Dir dir) noexcept
+inline constexpr Pos shiftForDir(const Dir dir) noexcept
 {
 	switch (dir) {
 	case Dir::Left:  return { -1,  0 };
@@ -197,25 +223,6 @@ inline std::string makeLower(const std::string_view & sv) noexcept
 }
 
 
-template <typename T>
-using RemoveFromQueueOp = std::function<bool(const T & item)>;
-
-template <typename T>
-inline void removeFromQueue(std::queue<T> & queue, const RemoveFromQueueOp<T> & op) noexcept
-{
-	std::queue<T> next;
-	while (!queue.empty()) {
-		T item = queue.front();
-		queue.pop();
-		if (!op(item)) {
-			next.push(std::move(item));
-		}
-	}
-	std::swap(queue, next);
-}
-
-
-
 inline static constexpr std::initializer_list<Dir> kAllDirs =
 		{Dir::Left, Dir::Right, Dir::Up, Dir::Down};
 inline static constexpr std::initializer_list<Color> kAllColors =
@@ -223,6 +230,11 @@ inline static constexpr std::initializer_list<Color> kAllColors =
 inline static constexpr std::initializer_list<Category> kAllCategories =
 		{Category::Base, Category::NC17, Category::Xtra};
 
+inline static constexpr int kMaxMapSize = 32;
+inline static constexpr int kMaxCellCount = kMaxMapSize * kMaxMapSize;
+
 inline static constexpr int kMaxTeleportCount = kAllColors.size() * 4;
+inline static constexpr int kMaxDudeCount = 32;
+inline static constexpr int kMaxMineCount = 16;
 
 inline static constexpr std::string_view kSerieExtension = ".camp";
@@ -0,0 +1,38 @@
+# Solves LEVEL with LEVEL_SOLVER, the solver compiled for it, and with GENERIC_SOLVER -g, the generic player,
+# and fails unless both find wins of the same lengths through the same steps:
+# cmake -DLEVEL_SOLVER=<solver> -DGENERIC_SOLVER=<solver> -DLEVEL=<level file> -P CompareSolutions.cmake
+
+foreach(var LEVEL_SOLVER GENERIC_SOLVER LEVEL)
+	if(NOT DEFINED ${var})
+		message(FATAL_ERROR "${var} is not set")
+	endif()
+endforeach()
+
+# the lengths and steps of the wins a solver prints, without the ids of their moves
+function(solve result)
+	execute_process(
+		COMMAND ${ARGN} "${LEVEL}"
+		OUTPUT_VARIABLE output
+		ERROR_VARIABLE output
+		RESULT_VARIABLE exit_code
+	)
+	if(NOT exit_code EQUAL 0)
+		message(FATAL_ERROR "${ARGN} failed (${exit_code}):\n${output}")
+	endif()
+
+	string(REGEX MATCHALL "win move: [0-9]+ \\(steps: [0-9]+\\)|\n *[0-9]+ (left|right|up|down)" wins "${output}")
+	string(REGEX REPLACE "win move: [0-9]+ |\n *[0-9]+ " "" wins "${wins}")
+	if(NOT wins)
+		message(FATAL_ERROR "${ARGN} found no win:\n${output}")
+	endif()
+	set(${result} "${wins}" PARENT_SCOPE)
+endfunction()
+
+solve(level_wins "${LEVEL_SOLVER}")
+solve(generic_wins "${GENERIC_SOLVER}" -g)
+
+if(NOT level_wins STREQUAL generic_wins)
+	message(FATAL_ERROR "The solvers disagree on ${LEVEL}:\nlevel player:   ${level_wins}\ngeneric player: ${generic_wins}")
+endif()
+
+message(STATUS "Same wins on ${LEVEL}: ${level_wins}")
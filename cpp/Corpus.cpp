@@ -0,0 +1,16 @@
+#include "Corpus.hpp"
+
+
+
+
+std::vector<std::filesystem::path> corpusPaths(const std::filesystem::path & dir)
+{
+	std::vector<std::filesystem::path> paths;
+	for (const std::filesystem::directory_entry & entry : std::filesystem::recursive_directory_iterator(dir)) {
+		if (entry.is_regular_file() && entry.path().extension() == kSerieExtension) {
+			paths.push_back(entry.path());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "Player.hpp"
+
+
+
+
+// the level files under a directory, in a stable order
+std::vector<std::filesystem::path> corpusPaths(const std::filesystem::path & dir);
+
+
+// every state a map gets to from a start, wins included, breadth first with the given player
+template <typename PlayerType = Player>
+std::unordered_set<State> reachableStates(const Map & map, const State & start)
+{
+	std::unordered_set<State> states = {start};
+	std::queue<const State*> statesLeft;
+	statesLeft.push(&*states.begin());
+
+	while (!statesLeft.empty()) {
+		const State & current = *statesLeft.front();
+		statesLeft.pop();
+		for (const Dir dir : kAllDirs) {
+			State state = current;
+			const Player::Result result = PlayerType::play(map, state, dir);
+			if (result == Player::Result::Fail) continue;
+			const auto p = states.insert(std::move(state));
+			if (p.second && result == Player::Result::None) {
+				statesLeft.push(&*p.first);
+			}
+		}
+	}
+
+	return states;
+}
@@ -0,0 +1,85 @@
+
+#pragma once
+
+#include "Map.hpp"
+
+
+
+
+// The map of one level known at compile time, as `slayawaycamp -H` generates it: Level holds the
+// buildIndex() tables of the map as constexpr arrays, so that a player specialized for it folds sizes,
+// walls, phones and teleports into its code.
+template <typename Level>
+class FixedMap {
+public:
+	static constexpr int width = Level::kWidth;
+	static constexpr int height = Level::kHeight;
+	static constexpr uint16_t mechanics = Level::kMechanics;
+	static constexpr Portal portal = Level::kPortal;
+	static constexpr auto & phones = Level::kPhones;
+
+	// map has to match(), which is left to the callers as it is too slow to check on every step
+	explicit FixedMap(const Map &) noexcept
+	{
+	}
+
+	// whether map is the level, down to what buildIndex() made of it
+	static bool matches(const Map & map) noexcept
+	{
+		return map.width == width && map.height == height && map.mechanics == mechanics &&
+				map.portal == portal &&
+				std::equal(map.cells.begin(), map.cells.end(), Level::kCells.begin(), Level::kCells.end()) &&
+				std::equal(map.phones.begin(), map.phones.end(), phones.begin(), phones.end()) &&
+				std::equal(map.phoneLines.begin(), map.phoneLines.end(),
+						Level::kPhoneLines.begin(), Level::kPhoneLines.end()) &&
+				std::equal(map.phoneLineCells.begin(), map.phoneLineCells.end(),
+						Level::kPhoneLineCells.begin(), Level::kPhoneLineCells.end());
+	}
+
+	static constexpr bool contains(const Pos & pos) noexcept
+	{
+		return pos.x >= 0 && pos.x < width && pos.y >= 0 && pos.y < height;
+	}
+
+	static constexpr int cellIndex(const Pos & pos) noexcept
+	{
+		return pos.y * width + pos.x;
+	}
+
+	static constexpr Pos posForCell(const int index) noexcept
+	{
+		return Pos{index % width, index / width};
+	}
+
+	static const Map::Cell & cell(const Pos & pos) noexcept
+	{
+		return contains(pos) ? Level::kCells[cellIndex(pos)] : Map::outsideCell();
+	}
+
+	static int slideLength(const Pos & pos, const Dir dir) noexcept
+	{
+		return cell(pos).slideLengths[int(dir)];
+	}
+
+	static std::span<const Pos> phoneLine(const int phoneIndex, const Dir dir) noexcept
+	{
+		const Map::PhoneLine & line = Level::kPhoneLines[phoneIndex][int(dir)];
+		return {Level::kPhoneLineCells.data() + line.begin, size_t(line.end - line.begin)};
+	}
+
+	static bool hasGum(const Pos & pos) noexcept { return cell(pos).has(Map::Cell::Gum); }
+	static bool hasTrap(const Pos & pos) noexcept { return cell(pos).has(Map::Cell::Trap); }
+	static bool hasPhone(const Pos & pos) noexcept { return cell(pos).has(Map::Cell::Phone); }
+	static bool hasTeleport(const Pos & pos) noexcept { return cell(pos).has(Map::Cell::Teleport); }
+	static bool hasAnyWall(const Pos & pos, const Dir dir) noexcept { return cell(pos).hasWall(dir); }
+	static bool hasTallWall(const Pos & pos, const Dir dir) noexcept { return cell(pos).hasTallWall(dir); }
+
+	static Phone getPhone(const Pos & pos) noexcept { return cell(pos).phone(pos); }
+	static Teleport getTeleport(const Pos & pos) noexcept { return cell(pos).teleport(pos); }
+	static Wall getWall(const Pos & pos, const Dir dir) noexcept { return cell(pos).wall(pos, dir); }
+
+	static Teleport getOtherTeleport(const Teleport & teleport) noexcept
+	{
+		return getTeleport(posForCell(cell(teleport.pos).otherTeleport));
+	}
+};
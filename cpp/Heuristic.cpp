@@ -0,0 +1,140 @@
+
+#include "Heuristic.hpp"
+
+#include <deque>
+
+
+
+
+Heuristic::Heuristic(const Map & map, const PatternDatabase * const patternDatabase) :
+	map_(map),
+	patternDatabase_(patternDatabase)
+{
+	assert(!patternDatabase || PatternDatabase::covers(map));
+
+	// scared and called victims die on their own in traps, on mines, on zap walls and under drops,
+	// so a single step can take a whole cluster of them; otherwise only the killer kills
+	oneKillPerStep_ = map.traps.empty() &&
+			(map.mechanics & (Mechanics::Mines | Mechanics::ZapWalls | Mechanics::Drops)) == 0;
+	hasPortal_ = map.portal.pos != Pos::null();
+
+	for (const std::vector<Wall> * const walls : {&map.hwalls, &map.vwalls}) {
+		for (const Wall & wall : *walls) {
+			if (wall.type == Wall::Type::Switch && wall.win) {
+				hasWinWall_ = true;
+			}
+		}
+	}
+
+	if (hasPortal_) {
+		_buildPortalDistances();
+	}
+}
+
+
+int Heuristic::estimate(const State & state) const noexcept
+{
+	const int victimCount = std::count_if(state.dudes.begin(), state.dudes.end(), [] (const Dude & dude) {
+		return dude.type == Dude::Type::Victim;
+	});
+
+	int estimate = 0;
+	if (victimCount != 0) {
+		// every cluster of victims takes a step, and the portal opens only on the step after the last kill
+		estimate = (oneKillPerStep_ ? victimCount : 1) + (hasPortal_ ? 1 : 0);
+
+		if (patternDatabase_) {
+			// the farthest victim takes its own distance, the nearest one its distance and a step per other one
+			int nearest = PatternDatabase::kUnreachable;
+			int farthest = 0;
+			for (const Dude & dude : state.dudes) {
+				if (dude.type == Dude::Type::Victim) {
+					const int distance = patternDatabase_->killDistance(state.killer.pos, dude.pos);
+					nearest = std::min(nearest, distance);
+					farthest = std::max(farthest, distance);
+				}
+			}
+			const int bound = std::max(farthest, nearest + victimCount - 1) + (hasPortal_ ? 1 : 0);
+			lookupCount_++;
+			if (bound > estimate) {
+				raiseCount_++;
+				estimate = bound;
+			}
+		}
+	} else if (hasPortal_) {
+		// starting on the portal does not count, the killer has to slide over it
+		estimate = std::max(1, portalDistances_[map_.cellIndex(state.killer.pos)]);
+	}
+
+	// a winning switch wall ends the level whatever is left
+	if (hasWinWall_) {
+		estimate = std::min(estimate, 1);
+	}
+
+	return estimate;
+}
+
+
+void Heuristic::_buildPortalDistances()
+{
+	// Slides through a graph of stopped and moving killers, walked backwards from the portal. Starting a slide
+	// costs a step; moving on, teleporting and stopping are free. Stopping anywhere makes up for the dudes
+	// the killer could bump into, so the distances never exceed the real ones.
+	const int cellCount = map_.cells.size();
+	const auto movingNode = [cellCount] (const int cell, const Dir dir) {
+		return cellCount + cell * 4 + int(dir);
+	};
+
+	std::vector<int> distances(cellCount * 5, kUnreachable);
+	std::deque<int> nodes;
+
+	const int portalCell = map_.cellIndex(map_.portal.pos);
+	for (const Dir dir : kAllDirs) {
+		distances[movingNode(portalCell, dir)] = 0;
+		nodes.push_back(movingNode(portalCell, dir));
+	}
+
+	const auto relax = [&distances, &nodes] (const int node, const int distance, const bool free) {
+		if (distance >= distances[node]) return;
+		distances[node] = distance;
+		if (free) {
+			nodes.push_front(node);
+		} else {
+			nodes.push_back(node);
+		}
+	};
+
+	while (!nodes.empty()) {
+		const int node = nodes.front();
+		nodes.pop_front();
+		const int distance = distances[node];
+
+		if (node < cellCount) {
+			// a stopped killer comes from one moving in any dir
+			for (const Dir dir : kAllDirs) {
+				relax(movingNode(node, dir), distance, true);
+			}
+			continue;
+		}
+
+		const int cell = (node - cellCount) / 4;
+		const Dir dir = Dir((node - cellCount) % 4);
+		const Pos pos = map_.posForCell(cell);
+
+		// started here
+		relax(cell, distance + 1, false);
+
+		// or slid in from the cell before
+		const Pos previousPos = pos + shiftForDir(oppositeDir(dir));
+		if (map_.contains(previousPos) && !map_.hasAnyWall(previousPos, dir)) {
+			relax(movingNode(map_.cellIndex(previousPos), dir), distance, true);
+		}
+
+		// or came out of the other teleport
+		if (map_.hasTeleport(pos)) {
+			relax(movingNode(map_.cell(pos).otherTeleport, dir), distance, true);
+		}
+	}
+
+	portalDistances_.assign(distances.begin(), distances.begin() + cellCount);
+}
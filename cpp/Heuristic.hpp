@@ -0,0 +1,45 @@
+
+#pragma once
+
+#include <vector>
+
+#include "Map.hpp"
+#include "PatternDatabase.hpp"
+
+
+
+
+// Admissible lower bound on the steps a state needs to win, for best-first search. Without a pattern database
+// it never decreases by more than one per step, so A* never finds a shorter path to a state it has already expanded.
+// Any class with the same estimate() can stand in for it in Solver.
+class Heuristic {
+public:
+	// the database, when given, has to cover the map
+	explicit Heuristic(const Map & map, const PatternDatabase * patternDatabase = nullptr);
+
+	int estimate(const State & state) const noexcept;
+
+	// estimates that looked the victims up in the pattern database, and those the database raised
+	int64_t lookupCount() const noexcept { return lookupCount_; }
+	int64_t raiseCount() const noexcept { return raiseCount_; }
+
+private:
+	// more than any board needs, for killers that cannot reach the portal at all
+	static constexpr int kUnreachable = kMaxCellCount;
+
+	void _buildPortalDistances();
+
+	const Map & map_;
+	const PatternDatabase * const patternDatabase_;
+
+	// each step kills at most one victim, unless scared ones can die on their own
+	bool oneKillPerStep_ = true;
+	bool hasPortal_ = false;
+	bool hasWinWall_ = false;
+
+	// the fewest slides from a cell to pass over the portal, stopping anywhere dudes could stop the killer
+	std::vector<int> portalDistances_;
+
+	mutable int64_t lookupCount_ = 0;
+	mutable int64_t raiseCount_ = 0;
+};
@@ -11,11 +11,6 @@
 
 
 
-static constexpr int kMaxMapSize = 16;
-
-
-
-
 static const QChar uqchar(const char * s) noexcept
 {
 	const QString qs = QString::fromUtf8(s);
@@ -834,10 +829,20 @@ Map Loader::_createMap(Map::Info && info, std::vector<QString> && lines) noexcep
 		}
 	}
 
+	assert(int(dudes.size()) <= kMaxDudeCount);
+	assert(int(mines.size()) <= kMaxMineCount);
+
 	std::sort(dudes.begin(), dudes.end());
 	std::sort(mines.begin(), mines.end());
 
-	return Map {
+	State state {
+		.killer = std::move(killer),
+		.dudes = std::move(dudes),
+		.mines = std::move(mines),
+	};
+	state.key = state.calculateKey();
+
+	Map map {
 		.info = std::move(info),
 		.width = width,
 		.height = height,
@@ -848,34 +853,65 @@ Map Loader::_createMap(Map::Info && info, std::vector<QString> && lines) noexcep
 		.gums = std::move(gums),
 		.teleports = std::move(teleports),
 		.portal = std::move(portal),
-		.state = State {
-			.killer= std::move(killer),
-			.dudes = std::move(dudes),
-			.mines = std::move(mines),
-		},
+		.state = std::move(state),
+		// filled in by buildIndex()
+		.cells = {},
+		.mechanics = 0,
+		.phoneLines = {},
+		.phoneLineCells = {},
 	};
+	map.buildIndex();
+	return map;
 }
 
 
 Map Loader::load(const std::filesystem::path & path) const noexcept
+{
+	std::vector<Map> maps = loadAll(path);
+	assert(maps.size() == 1);
+	return std::move(maps.front());
+}
+
+
+std::vector<Map> Loader::loadAll(const std::filesystem::path & path) const noexcept
 {
 	static constexpr std::string_view kShortNamePrefix = "name: ";
 	static constexpr std::string_view kFullNamePrefix = "full: ";
 	static constexpr std::string_view kMoobaaNamePrefix = "moba: ";
 	static constexpr std::string_view kTurnsPrefix = "turns: ";
+	// text presentation selector some glyphs of the samples carry, it takes no cell
+	static constexpr std::string_view kTextSelector = "\xef\xb8\x8e";
 
 	printf("Loading: %s\n", path.filename().c_str());
 	fflush(stdout);
 
+	std::vector<Map> maps;
 	Map::Info info;
 	std::vector<QString> lines;
 
+	// a map ends at the first blank line after its rows, unnamed ones are named after the file
+	const auto finishMap = [&maps, &info, &lines, &path] () {
+		if (lines.empty()) {
+			return;
+		}
+		if (info.shortName.empty()) {
+			info.shortName = makeLower(path.stem().string()) + " " + std::to_string(maps.size() + 1);
+		}
+		maps.push_back(_createMap(std::move(info), std::move(lines)));
+		info = {};
+		lines.clear();
+	};
+
 	{
 		std::ifstream file(path);
 		assert(file.good());
 		std::string line;
 		while (std::getline(file, line)) {
-			if (line.empty() || std::string_view(line).substr(0, 1) == "#") {
+			if (line.empty()) {
+				finishMap();
+				continue;
+			}
+			if (std::string_view(line).substr(0, 1) == "#") {
 				continue;
 			}
 			if (line.starts_with(kShortNamePrefix)) {
@@ -907,12 +943,16 @@ Map Loader::load(const std::filesystem::path & path) const noexcept
 				printf("Level turns: %d\n", info.turns);
 				continue;
 			}
+			for (std::size_t i = line.find(kTextSelector); i != std::string::npos; i = line.find(kTextSelector, i)) {
+				line.erase(i, kTextSelector.size());
+			}
 			const QString qline = QString::fromStdString(line);
 			lines.push_back(std::move(qline));
 		}
 	}
+	finishMap();
 
-	return _createMap(std::move(info), std::move(lines));
+	return maps;
 }
 
 
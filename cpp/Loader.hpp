@@ -16,6 +16,7 @@ public:
 	Loader();
 
 	Map load(const std::filesystem::path & path) const noexcept;
+	std::vector<Map> loadAll(const std::filesystem::path & path) const noexcept; // the maps of a file, in order
 	std::vector<QString> convert(const Map & map) const noexcept;
 	void draw(const Map & map) const noexcept;
 	void save(const std::filesystem::path & path, const Map & map) const noexcept;
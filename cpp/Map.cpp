@@ -14,13 +14,13 @@ const Wall * Map::findWall(const Pos & pos, const Dir dir) const noexcept
 	const auto wallPos = [&shift, &pos, wallShift] () -> Pos {
 		if (shift.x != 0) {
 			return Pos {
-				.x = pos.x + wallShift,
-				.y = pos.y,
+				pos.x + wallShift,
+				pos.y,
 			};
 		} else {
 			return Pos {
-				.x = pos.x,
-				.y = pos.y + wallShift,
+				pos.x,
+				pos.y + wallShift,
 			};
 		}
 	}();
@@ -36,48 +36,128 @@ const Wall * Map::findWall(const Pos & pos, const Dir dir) const noexcept
 }
 
 
-const Wall & Map::getWall(const Pos & pos, const Dir dir) const noexcept
+Teleport Map::getOtherTeleport(const Teleport & teleport) const noexcept
 {
-	const Wall * const pwall = findWall(pos, dir);
-	assert(pwall);
-	return *pwall;
+	const Cell & c = cell(teleport.pos);
+	assert(c.has(Cell::Teleport));
+	return getTeleport(posForCell(c.otherTeleport));
 }
 
 
-bool Map::hasAnyWall(const Pos & pos, const Dir dir) const noexcept
+void Map::buildIndex() noexcept
 {
-	const Wall * const pwall = findWall(pos, dir);
-	return pwall != nullptr;
-}
+	assert(width <= kMaxMapSize && height <= kMaxMapSize);
 
+	cells.assign(width * height, Cell{});
 
-bool Map::hasTallWall(const Pos & pos, const Dir dir) const noexcept
-{
-	const Wall * const pwall = findWall(pos, dir);
-	if (!pwall) {
-		return false;
-	} else {
-		switch (pwall->type) {
-		case Wall::Type::Normal:
-		case Wall::Type::Switch:
-			return true;
-		case Wall::Type::Escape:
-		case Wall::Type::Short:
-		case Wall::Type::Zap:
-			return false;
+	for (int index = 0; index < int(cells.size()); ++index) {
+		const Pos pos = posForCell(index);
+		Cell & cell = cells[index];
+
+		for (const Dir dir : kAllDirs) {
+			const Wall * const wall = findWall(pos, dir);
+			if (!wall) continue;
+
+			cell.walls |= ((int(wall->type) + 1) | (wall->win ? 0x8 : 0)) << (int(dir) * 4);
+
+			switch (wall->type) {
+			case Wall::Type::Normal:
+			case Wall::Type::Switch:
+				cell.tallWalls |= 1 << int(dir);
+				break;
+			case Wall::Type::Escape:
+			case Wall::Type::Short:
+			case Wall::Type::Zap:
+				break;
+			}
 		}
-		assert(false);
 	}
-}
 
+	for (const Trap & trap : traps) {
+		cells[cellIndex(trap.pos)].flags |= Cell::Trap;
+	}
 
-const Teleport & Map::getOtherTeleport(const Teleport & teleport) const noexcept
-{
-	const auto it = std::find_if(teleports.begin(), teleports.end(),
-			[&teleport] (const Teleport & t) {
-				if (t.pos == teleport.pos) return false;
-				return t.color == teleport.color;
-			});
-	assert(it != teleports.end());
-	return *it;
+	for (const Gum & gum : gums) {
+		cells[cellIndex(gum.pos)].flags |= Cell::Gum;
+	}
+
+	if (portal.pos != Pos::null()) {
+		cells[cellIndex(portal.pos)].flags |= Cell::Portal;
+	}
+
+	for (const Phone & phone : phones) {
+		Cell & cell = cells[cellIndex(phone.pos)];
+		cell.flags |= Cell::Phone;
+		cell.phoneColor = int(phone.color);
+	}
+
+	for (const Teleport & teleport : teleports) {
+		const auto it = std::find_if(teleports.begin(), teleports.end(),
+				[&teleport] (const Teleport & t) {
+					if (t.pos == teleport.pos) return false;
+					return t.color == teleport.color;
+				});
+		assert(it != teleports.end());
+
+		Cell & cell = cells[cellIndex(teleport.pos)];
+		cell.flags |= Cell::Teleport;
+		cell.teleportColor = int(teleport.color);
+		cell.otherTeleport = cellIndex(it->pos);
+	}
+
+	phoneLines.assign(phones.size(), {});
+	phoneLineCells.clear();
+
+	for (int i = 0; i < int(phones.size()); ++i) {
+		for (const Dir dir : kAllDirs) {
+			// a call passes anything but tall walls, the first dude on the line answers
+			PhoneLine & line = phoneLines[i][int(dir)];
+			line.begin = phoneLineCells.size();
+			for (Pos pos = phones[i].pos; !hasTallWall(pos, dir);) {
+				pos = pos + shiftForDir(dir);
+				if (!contains(pos)) break;
+				phoneLineCells.push_back(pos);
+			}
+			line.end = phoneLineCells.size();
+		}
+	}
+
+	mechanics = 0;
+	for (const Dude & dude : state.dudes) {
+		switch (dude.type) {
+		case Dude::Type::Cop:   mechanics |= Mechanics::Cops; break;
+		case Dude::Type::Swat:  mechanics |= Mechanics::Swats; break;
+		case Dude::Type::Drop:  mechanics |= Mechanics::Drops; break;
+		case Dude::Type::Victim:
+		case Dude::Type::Cat:
+			break;
+		}
+	}
+	for (const std::vector<Wall> * const walls : {&hwalls, &vwalls}) {
+		for (const Wall & wall : *walls) {
+			if (wall.type == Wall::Type::Zap) mechanics |= Mechanics::ZapWalls;
+			if (wall.type == Wall::Type::Switch) mechanics |= Mechanics::SwitchWalls;
+		}
+	}
+	if (!phones.empty()) mechanics |= Mechanics::Phones;
+	if (!teleports.empty()) mechanics |= Mechanics::Teleports;
+	if (!state.mines.empty()) mechanics |= Mechanics::Mines;
+	if (!gums.empty()) mechanics |= Mechanics::Gums;
+	if (portal.pos != Pos::null()) mechanics |= Mechanics::Portal;
+
+	static constexpr uint8_t kStopFlags = Cell::Trap | Cell::Gum | Cell::Portal | Cell::Phone | Cell::Teleport;
+
+	for (int index = 0; index < int(cells.size()); ++index) {
+		for (const Dir dir : kAllDirs) {
+			// a slide passes a cell only when no wall, phone, trap, teleport, portal or gum is in the way
+			int length = 0;
+			for (Pos pos = posForCell(index);; ++length) {
+				const Pos nextPos = pos + shiftForDir(dir);
+				if (hasAnyWall(pos, dir) || !contains(nextPos)) break;
+				if (cell(nextPos).flags & kStopFlags) break;
+				pos = nextPos;
+			}
+			cells[index].slideLengths[int(dir)] = length;
+		}
+	}
 }
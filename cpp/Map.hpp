@@ -1,7 +1,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <span>
 
 #include "State.hpp"
 
@@ -97,6 +99,27 @@ struct Trap {
 
 
 
+// Mechanics a map uses, found by Map::buildIndex(). Player is specialized for sets of them.
+struct Mechanics {
+	enum Flag : uint16_t {
+		Cops        = 1 << 0,
+		Swats       = 1 << 1,
+		Drops       = 1 << 2,
+		Phones      = 1 << 3,
+		Teleports   = 1 << 4,
+		Mines       = 1 << 5,
+		ZapWalls    = 1 << 6,
+		SwitchWalls = 1 << 7,
+		Gums        = 1 << 8,
+		Portal      = 1 << 9,
+	};
+
+	static constexpr uint16_t kAll = (1 << 10) - 1;
+};
+
+
+
+
 struct Map {
 	struct Info {
 		std::string shortName;
@@ -105,6 +128,38 @@ struct Map {
 		int turns = -1;
 	};
 
+	// static contents of a single cell, precomputed by buildIndex()
+	struct Cell {
+		enum Flag : uint8_t {
+			Trap     = 1 << 0,
+			Gum      = 1 << 1,
+			Portal   = 1 << 2,
+			Phone    = 1 << 3,
+			Teleport = 1 << 4,
+		};
+
+		uint16_t walls = 0; // nibble per dir: wall type + 1 and win bit, zero when there is no wall
+		uint8_t tallWalls = 0; // bit per dir
+		uint8_t flags = 0;
+		uint8_t phoneColor = 0;
+		uint8_t teleportColor = 0;
+		uint16_t otherTeleport = 0; // cell index of the paired teleport
+		std::array<uint8_t, 4> slideLengths {}; // cells passed per dir before anything static stops or redirects a slide
+
+		constexpr int wallBits(const Dir dir) const noexcept { return (walls >> (int(dir) * 4)) & 0xf; }
+		constexpr bool hasWall(const Dir dir) const noexcept { return wallBits(dir) != 0; }
+		constexpr bool hasTallWall(const Dir dir) const noexcept { return tallWalls & (1 << int(dir)); }
+		constexpr uint8_t openDirs() const noexcept { return ~tallWalls & 0xf; } // bit per dir a scare reaches
+		constexpr bool has(const Flag flag) const noexcept { return flags & flag; }
+
+		// the wall, phone or teleport of the cell, which lies at pos
+		Wall wall(const Pos & pos, Dir dir) const noexcept;
+		::Phone phone(const Pos & pos) const noexcept;
+		::Teleport teleport(const Pos & pos) const noexcept;
+
+		bool operator==(const Cell & other) const noexcept = default;
+	};
+
 	Info info;
 	int width, height;
 	std::vector<Wall> hwalls;
@@ -115,38 +170,91 @@ struct Map {
 	std::vector<Teleport> teleports;
 	Portal portal;
 	State state;
+	std::vector<Cell> cells;
+	uint16_t mechanics = 0;
+
+	// cells a call from phones[i] reaches in each dir, up to a tall wall, precomputed by buildIndex()
+	struct PhoneLine {
+		int begin = 0;
+		int end = 0;
+
+		bool operator==(const PhoneLine & other) const noexcept = default;
+	};
+	std::vector<std::array<PhoneLine, 4>> phoneLines;
+	std::vector<Pos> phoneLineCells;
+
+	void buildIndex() noexcept;
 
 	bool contains(const Pos & pos) const noexcept
 	{
 		return pos.x >= 0 && pos.x < width && pos.y >= 0 && pos.y < height;
 	}
 
-	auto findGum(const Pos & pos) const noexcept
+	int cellIndex(const Pos & pos) const noexcept
 	{
-		return std::find_if(gums.begin(), gums.end(), [&pos] (const Gum & gum) {
-			return gum.pos == pos;
-		});
+		return pos.y * width + pos.x;
+	}
+
+	Pos posForCell(const int index) const noexcept
+	{
+		return Pos{index % width, index / width};
+	}
+
+	// anything outside of the board behaves like a cell walled in on every side
+	static const Cell & outsideCell() noexcept
+	{
+		static constexpr Cell kOutsideCell {
+			.walls = 0x1111,
+			.tallWalls = 0xf,
+		};
+		return kOutsideCell;
+	}
+
+	const Cell & cell(const Pos & pos) const noexcept
+	{
+		assert(!cells.empty());
+		return contains(pos) ? cells[cellIndex(pos)] : outsideCell();
+	}
+
+	int slideLength(const Pos & pos, const Dir dir) const noexcept
+	{
+		return cell(pos).slideLengths[int(dir)];
+	}
+
+	std::span<const Pos> phoneLine(const int phoneIndex, const Dir dir) const noexcept
+	{
+		const PhoneLine & line = phoneLines[phoneIndex][int(dir)];
+		return {phoneLineCells.data() + line.begin, size_t(line.end - line.begin)};
 	}
 
 	bool hasGum(const Pos & pos) const noexcept
 	{
-		return findGum(pos) != gums.end();
+		return cell(pos).has(Cell::Gum);
 	}
 
-	auto findPhone(const Pos & pos) const noexcept
+	bool hasTrap(const Pos & pos) const noexcept
 	{
-		return std::find_if(phones.begin(), phones.end(), [&pos] (const Phone & phone) {
-			return phone.pos == pos;
-		});
+		return cell(pos).has(Cell::Trap);
 	}
 
-	const Phone & getPhone(const Pos & pos) const
+	bool hasPhone(const Pos & pos) const noexcept
 	{
-		const auto it = std::find_if(phones.begin(), phones.end(), [&pos] (const Phone & phone) {
-			return phone.pos == pos;
-		});
-		assert(it != phones.end());
-		return *it;
+		return cell(pos).has(Cell::Phone);
+	}
+
+	Phone getPhone(const Pos & pos) const noexcept
+	{
+		return cell(pos).phone(pos);
+	}
+
+	bool hasTeleport(const Pos & pos) const noexcept
+	{
+		return cell(pos).has(Cell::Teleport);
+	}
+
+	Teleport getTeleport(const Pos & pos) const noexcept
+	{
+		return cell(pos).teleport(pos);
 	}
 
 	auto findTeleport(const Pos & pos) const noexcept
@@ -157,10 +265,10 @@ struct Map {
 	}
 
 	const Wall * findWall(const Pos & pos, Dir dir) const noexcept;
-	const Wall & getWall(const Pos & pos, Dir dir) const noexcept;
+	Wall getWall(const Pos & pos, Dir dir) const noexcept { return cell(pos).wall(pos, dir); }
 	bool hasAnyWall(const Pos & pos, Dir dir) const noexcept;
 	bool hasTallWall(const Pos & pos, Dir dir) const noexcept;
-	const Teleport & getOtherTeleport(const Teleport & teleport) const noexcept;
+	Teleport getOtherTeleport(const Teleport & teleport) const noexcept;
 
 	bool operator==(const Map & other) const noexcept;
 };
@@ -168,6 +276,57 @@ struct Map {
 
 
 
+inline Wall Map::Cell::wall(const Pos & pos, const Dir dir) const noexcept
+{
+	const int bits = wallBits(dir);
+	assert(bits != 0);
+
+	const Pos shift = shiftForDir(dir);
+	const bool after = shift.x + shift.y == 1;
+
+	return Wall {
+		.type = Wall::Type((bits & 0x7) - 1),
+		.pos = Pos {
+			pos.x + (shift.x != 0 && after ? 1 : 0),
+			pos.y + (shift.y != 0 && after ? 1 : 0),
+		},
+		.win = (bits & 0x8) != 0,
+	};
+}
+
+
+inline Phone Map::Cell::phone(const Pos & pos) const noexcept
+{
+	assert(has(Phone));
+	return ::Phone {
+		.pos = pos,
+		.color = Color(phoneColor),
+	};
+}
+
+
+inline Teleport Map::Cell::teleport(const Pos & pos) const noexcept
+{
+	assert(has(Teleport));
+	return ::Teleport {
+		.pos = pos,
+		.color = Color(teleportColor),
+	};
+}
+
+
+inline bool Map::hasAnyWall(const Pos & pos, const Dir dir) const noexcept
+{
+	return cell(pos).hasWall(dir);
+}
+
+
+inline bool Map::hasTallWall(const Pos & pos, const Dir dir) const noexcept
+{
+	return cell(pos).hasTallWall(dir);
+}
+
+
 inline bool Map::operator==(const Map & other) const noexcept
 {
 	// if (info != other.info) return false;
@@ -0,0 +1,69 @@
+#include "MoveStore.hpp"
+
+#include <limits>
+
+
+
+
+MoveStore::MoveStore(const int wordCount) :
+	wordCount_(wordCount)
+{
+}
+
+
+int MoveStore::add(const int previousId, const Dir dir, const PackedWord * const words) noexcept
+{
+	const int id = size_;
+	const int index = _index(id);
+
+	if (index == 0) {
+		segments_.push_back(Segment {
+			.previousIds = std::make_unique<int[]>(kMovesPerSegment),
+			.depths = std::make_unique<uint16_t[]>(kMovesPerSegment),
+			.dirs = std::make_unique<uint8_t[]>(kMovesPerSegment / kDirsPerByte),
+			.states = std::make_unique<PackedWord[]>(kMovesPerSegment * wordCount_),
+		});
+	}
+
+	Segment & segment = segments_.back();
+
+	const int depth = previousId == -1 ? 0 : this->depth(previousId) + 1;
+	assert(depth <= std::numeric_limits<uint16_t>::max());
+
+	segment.previousIds[index] = previousId;
+	segment.depths[index] = depth;
+
+	if (previousId != -1) {
+		// the initial move has no direction and keeps zero bits
+		segment.dirs[index / kDirsPerByte] |= int(dir) << (index % kDirsPerByte * 2);
+	}
+
+	std::copy_n(words, wordCount_, segment.states.get() + index * wordCount_);
+
+	size_++;
+	return id;
+}
+
+
+void MoveStore::relink(const int id, const int previousId, const Dir dir) noexcept
+{
+	assert(previousId != -1 && this->previousId(id) != -1);
+
+	Segment & segment = segments_[id >> kSegmentShift];
+	const int index = _index(id);
+
+	segment.previousIds[index] = previousId;
+	segment.depths[index] = depth(previousId) + 1;
+
+	uint8_t & dirs = segment.dirs[index / kDirsPerByte];
+	const int shift = index % kDirsPerByte * 2;
+	dirs = (dirs & ~(0x3 << shift)) | (int(dir) << shift);
+}
+
+
+void MoveStore::clear() noexcept
+{
+	// segments are freed rather than reused, as add() counts on fresh ones being zeroed
+	segments_.clear();
+	size_ = 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Packer.hpp"
+
+
+
+
+// Moves kept column by column in fixed-size segments, which never move once allocated.
+class MoveStore {
+public:
+	MoveStore(int wordCount);
+
+	int size() const noexcept { return size_; }
+
+	int add(int previousId, Dir dir, const PackedWord * words) noexcept;
+
+	// reaches a move from another previous one, for searches that can find a shorter path later
+	void relink(int id, int previousId, Dir dir) noexcept;
+
+	// drops every move, for searches that start over
+	void clear() noexcept;
+
+	int previousId(int id) const noexcept;
+	Dir dir(int id) const noexcept;
+	int depth(int id) const noexcept;
+	const PackedWord * packedState(int id) const noexcept;
+
+private:
+	static constexpr int kSegmentShift = 14;
+	static constexpr int kMovesPerSegment = 1 << kSegmentShift;
+	static constexpr int kDirsPerByte = 4;
+
+	struct Segment {
+		std::unique_ptr<int[]> previousIds;
+		std::unique_ptr<uint16_t[]> depths;
+		std::unique_ptr<uint8_t[]> dirs;
+		std::unique_ptr<PackedWord[]> states;
+	};
+
+	const Segment & _segment(int id) const noexcept { return segments_[id >> kSegmentShift]; }
+	static int _index(int id) noexcept { return id & (kMovesPerSegment - 1); }
+
+	const int wordCount_;
+	std::vector<Segment> segments_;
+	int size_ = 0;
+};
+
+
+
+
+inline int MoveStore::previousId(const int id) const noexcept
+{
+	return _segment(id).previousIds[_index(id)];
+}
+
+
+inline Dir MoveStore::dir(const int id) const noexcept
+{
+	const int index = _index(id);
+	const uint8_t dirs = _segment(id).dirs[index / kDirsPerByte];
+	return Dir((dirs >> (index % kDirsPerByte * 2)) & 0x3);
+}
+
+
+inline int MoveStore::depth(const int id) const noexcept
+{
+	return _segment(id).depths[_index(id)];
+}
+
+
+inline const PackedWord * MoveStore::packedState(const int id) const noexcept
+{
+	return _segment(id).states.get() + _index(id) * wordCount_;
+}
@@ -0,0 +1,175 @@
+#include "Packer.hpp"
+
+#include <bit>
+#include <cstring>
+
+
+
+
+static constexpr int kWordBits = sizeof(PackedWord) * 8;
+
+
+
+
+static int bitsForCount(const int count) noexcept
+{
+	return count <= 1 ? 0 : std::bit_width(unsigned(count - 1));
+}
+
+
+static void writeBits(PackedWord * const words, int & offset, const int bits, const uint64_t value) noexcept
+{
+	assert(bits == 64 || value < (uint64_t(1) << bits));
+	for (int written = 0; written < bits;) {
+		const int wordIndex = offset / kWordBits;
+		const int shift = offset % kWordBits;
+		const int count = std::min(bits - written, kWordBits - shift);
+		words[wordIndex] |= (value >> written) << shift;
+		written += count;
+		offset += count;
+	}
+}
+
+
+static uint64_t readBits(const PackedWord * const words, int & offset, const int bits) noexcept
+{
+	uint64_t value = 0;
+	for (int read = 0; read < bits;) {
+		const int wordIndex = offset / kWordBits;
+		const int shift = offset % kWordBits;
+		const int count = std::min(bits - read, kWordBits - shift);
+		const uint64_t mask = count == kWordBits ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+		value |= ((words[wordIndex] >> shift) & mask) << read;
+		read += count;
+		offset += count;
+	}
+	return value;
+}
+
+
+
+
+Packer::Packer(const Map & map) :
+	width_(map.width),
+	posBits_(bitsForCount(map.width * map.height)),
+	mines_(map.state.mines),
+	maxDudeCount_(map.state.dudes.size()),
+	dudeCountBits_(bitsForCount(maxDudeCount_ + 1)),
+	dudeBits_(kDudeTypeBits + posBits_ + kDudeExtraBits),
+	wordCount_([this] () -> int {
+		const int bits = kWordBits + posBits_ + 1 + int(mines_.size()) + dudeCountBits_ + maxDudeCount_ * dudeBits_;
+		return (bits + kWordBits - 1) / kWordBits;
+	}())
+{
+}
+
+
+void Packer::pack(const State & state, PackedWord * const words) const noexcept
+{
+	assert(int(state.dudes.size()) <= maxDudeCount_);
+	assert(state.key == state.calculateKey());
+
+	std::memset(words, 0, wordCount_ * sizeof(PackedWord));
+
+	// the zobrist key leads, so it serves both as the hash and as a fingerprint
+	words[0] = state.key;
+
+	int offset = kWordBits;
+
+	writeBits(words, offset, posBits_, _posToIndex(state.killer.pos));
+	writeBits(words, offset, 1, state.light);
+
+	{
+		// mines can only be removed, so a bit per initial mine is enough
+		auto it = state.mines.begin();
+		for (const Mine & mine : mines_) {
+			const bool alive = it != state.mines.end() && *it == mine;
+			writeBits(words, offset, 1, alive);
+			if (alive) ++it;
+		}
+		assert(it == state.mines.end());
+	}
+
+	writeBits(words, offset, dudeCountBits_, state.dudes.size());
+
+	for (const Dude & dude : state.dudes) {
+		writeBits(words, offset, kDudeTypeBits, int(dude.type));
+		writeBits(words, offset, posBits_, _posToIndex(dude.pos));
+		switch (dude.type) {
+		case Dude::Type::Cop:
+		case Dude::Type::Swat:
+			writeBits(words, offset, kDudeExtraBits, int(dude.dir));
+			break;
+		case Dude::Type::Drop:
+			writeBits(words, offset, kDudeExtraBits, int(dude.orientation));
+			break;
+		case Dude::Type::Victim:
+		case Dude::Type::Cat:
+			offset += kDudeExtraBits;
+			break;
+		}
+	}
+}
+
+
+State Packer::unpack(const PackedWord * const words) const noexcept
+{
+	State state;
+	unpack(words, state);
+	return state;
+}
+
+
+void Packer::unpack(const PackedWord * const words, State & state) const noexcept
+{
+	state.mines.clear();
+	state.dudes.clear();
+	state.key = words[0];
+
+	int offset = kWordBits;
+
+	state.killer.pos = _indexToPos(readBits(words, offset, posBits_));
+	state.light = readBits(words, offset, 1);
+
+	for (const Mine & mine : mines_) {
+		if (readBits(words, offset, 1)) {
+			state.mines.push_back(mine);
+		}
+	}
+
+	const int dudeCount = readBits(words, offset, dudeCountBits_);
+
+	for (int i = 0; i < dudeCount; ++i) {
+		Dude dude {
+			.type = Dude::Type(readBits(words, offset, kDudeTypeBits)),
+			.pos = _indexToPos(readBits(words, offset, posBits_)),
+		};
+		const int extra = readBits(words, offset, kDudeExtraBits);
+		switch (dude.type) {
+		case Dude::Type::Cop:
+		case Dude::Type::Swat:
+			dude.dir = Dir(extra);
+			break;
+		case Dude::Type::Drop:
+			dude.orientation = Orientation(extra);
+			break;
+		case Dude::Type::Victim:
+		case Dude::Type::Cat:
+			break;
+		}
+		state.dudes.push_back(std::move(dude));
+	}
+}
+
+
+std::size_t Packer::hash(const PackedWord * const words) const noexcept
+{
+	return words[0];
+}
+
+
+bool Packer::equals(const PackedWord * const a, const PackedWord * const b) const noexcept
+{
+	if (a[0] != b[0]) return false;
+	return std::memcmp(a + 1, b + 1, (wordCount_ - 1) * sizeof(PackedWord)) == 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Map.hpp"
+
+
+
+
+using PackedWord = uint64_t;
+
+
+
+
+class Packer {
+public:
+	Packer(const Map & map);
+
+	int wordCount() const noexcept { return wordCount_; }
+
+	void pack(const State & state, PackedWord * words) const noexcept;
+	State unpack(const PackedWord * words) const noexcept;
+	// reuses the vectors of the given state, so it does not allocate once they are large enough
+	void unpack(const PackedWord * words, State & state) const noexcept;
+
+	std::size_t hash(const PackedWord * words) const noexcept;
+	bool equals(const PackedWord * a, const PackedWord * b) const noexcept;
+
+private:
+	static constexpr int kDudeTypeBits = 3;
+	static constexpr int kDudeExtraBits = 2;
+
+	int _posToIndex(const Pos & pos) const noexcept;
+	Pos _indexToPos(int index) const noexcept;
+
+	const int width_;
+	const int posBits_;
+	const std::vector<Mine> mines_;
+	const int maxDudeCount_;
+	const int dudeCountBits_;
+	const int dudeBits_;
+	const int wordCount_;
+};
+
+
+
+
+inline int Packer::_posToIndex(const Pos & pos) const noexcept
+{
+	return pos.y * width_ + pos.x;
+}
+
+
+inline Pos Packer::_indexToPos(const int index) const noexcept
+{
+	return Pos {
+		index % width_,
+		index / width_,
+	};
+}
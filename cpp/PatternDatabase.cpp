@@ -0,0 +1,178 @@
+
+#include "PatternDatabase.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <optional>
+
+
+
+
+PatternDatabase::PatternDatabase(const Map & map, const std::filesystem::path & cachePath) :
+	width_(map.width),
+	cellCount_(map.cells.size())
+{
+	assert(covers(map));
+
+	const uint64_t fingerprint = _fingerprint(map);
+	if (!cachePath.empty() && _load(cachePath, fingerprint)) {
+		loaded_ = true;
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	_build(map);
+	buildSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!cachePath.empty()) {
+		_save(cachePath, fingerprint);
+	}
+}
+
+
+bool PatternDatabase::covers(const Map & map) noexcept
+{
+	static constexpr uint16_t kOtherKillers = Mechanics::Mines | Mechanics::ZapWalls | Mechanics::Drops;
+	// the killer passing a teleport scares the dudes around it, which the abstract game does not play
+	static constexpr uint16_t kOtherScares = Mechanics::Phones | Mechanics::Teleports;
+
+	return map.traps.empty() && (map.mechanics & (kOtherKillers | kOtherScares)) == 0 &&
+			int(map.cells.size()) <= kMaxBuiltCellCount;
+}
+
+
+uint64_t PatternDatabase::_fingerprint(const Map & map) noexcept
+{
+	// what the abstract game reads from the map
+	uint64_t hash = mixHash(uint64_t(map.width) << 32 | map.height);
+	for (const Map::Cell & cell : map.cells) {
+		hash = mixHash(hash ^ (uint64_t(cell.walls) | uint64_t(cell.flags) << 16));
+	}
+	return hash;
+}
+
+
+void PatternDatabase::_build(const Map & map)
+{
+	const int cellCount = cellCount_;
+	distances_.assign(cellCount * cellCount, kUnreachable);
+
+	// Cells a slide from pos in dir can end at, stopping anywhere up to the first wall. Returns whether the slide
+	// runs into target on the way.
+	const auto slide = [&map] (const Pos & from, const Dir dir, const Pos & target, std::vector<Pos> & stops) -> bool {
+		const Pos shift = shiftForDir(dir);
+		stops.clear();
+		for (Pos pos = from;; pos = pos + shift) {
+			stops.push_back(pos);
+			const Pos nextPos = pos + shift;
+			if (map.hasAnyWall(pos, dir) || !map.contains(nextPos)) {
+				return false;
+			}
+			if (nextPos == target) {
+				return true;
+			}
+		}
+	};
+
+	const auto fleeDir = [] (const Pos & from, const Pos & victim) -> std::optional<Dir> {
+		for (const Dir dir : kAllDirs) {
+			if (from + shiftForDir(dir) == victim) {
+				return dir;
+			}
+		}
+		return std::nullopt;
+	};
+
+	std::vector<Pos> killerStops;
+	std::vector<Pos> victimStops;
+
+	// whether a step from killer and victim kills the victim, or leads where it is killed in distance steps
+	const auto leadsTo = [&] (const Pos & killer, const Pos & victim, const int distance) -> bool {
+		const auto at = [this, cellCount, distance] (const Pos & killer, const Pos & victim) {
+			return distances_[_cellIndex(killer) * cellCount + _cellIndex(victim)] == distance;
+		};
+
+		// the victim flees from the killer or from a dude killed next to it, stopping anywhere on the way
+		const auto flees = [&] (const Pos & killer, const Pos & from) -> bool {
+			const std::optional<Dir> dir = fleeDir(from, victim);
+			if (!dir) {
+				return false;
+			}
+			slide(victim, *dir, Pos::null(), victimStops);
+			return std::any_of(victimStops.begin(), victimStops.end(), [&at, &killer] (const Pos & pos) {
+				return at(killer, pos);
+			});
+		};
+
+		for (const Dir dir : kAllDirs) {
+			if (slide(killer, dir, victim, killerStops) && distance == 0) {
+				return true;
+			}
+			// copied, the flights slide again
+			const std::vector<Pos> stops = killerStops;
+			for (const Pos & stop : stops) {
+				if (at(stop, victim) || flees(stop, stop)) {
+					return true;
+				}
+				const Pos bumped = stop + shiftForDir(dir);
+				if (!map.hasAnyWall(stop, dir) && map.contains(bumped) && bumped != victim && flees(stop, bumped)) {
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+
+	for (int distance = 1; distance < kUnreachable; ++distance) {
+		bool changed = false;
+		for (int killerIndex = 0; killerIndex < cellCount; ++killerIndex) {
+			for (int victimIndex = 0; victimIndex < cellCount; ++victimIndex) {
+				uint8_t & entry = distances_[killerIndex * cellCount + victimIndex];
+				if (entry != kUnreachable) {
+					continue;
+				}
+				if (leadsTo(map.posForCell(killerIndex), map.posForCell(victimIndex), distance - 1)) {
+					entry = distance;
+					changed = true;
+				}
+			}
+		}
+		if (!changed) {
+			break;
+		}
+	}
+}
+
+
+bool PatternDatabase::_load(const std::filesystem::path & path, const uint64_t fingerprint)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.good()) {
+		return false;
+	}
+
+	uint32_t header[2] = {};
+	uint64_t fileFingerprint = 0;
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	file.read(reinterpret_cast<char*>(&fileFingerprint), sizeof(fileFingerprint));
+	if (!file.good() || header[0] != kMagic || header[1] != uint32_t(cellCount_) || fileFingerprint != fingerprint) {
+		return false;
+	}
+
+	distances_.resize(cellCount_ * cellCount_);
+	file.read(reinterpret_cast<char*>(distances_.data()), distances_.size());
+	return file.good();
+}
+
+
+void PatternDatabase::_save(const std::filesystem::path & path, const uint64_t fingerprint) const
+{
+	std::ofstream file(path, std::ios::binary);
+	assert(file.good());
+
+	const uint32_t header[2] = {kMagic, uint32_t(cellCount_)};
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+	file.write(reinterpret_cast<const char*>(distances_.data()), distances_.size());
+	assert(file.good());
+}
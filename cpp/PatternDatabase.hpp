@@ -0,0 +1,60 @@
+
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "Map.hpp"
+
+
+
+
+// Exact kill distances of an abstract game with the killer and a single victim, for every pair of cells.
+// Everything else is left out of the abstract game, so it lets the killer stop anywhere along a slide and the
+// victim stop anywhere along a flight; the dudes it drops could stop them there. A victim flees from where the
+// killer stops, or from a dude killed next to it, which is all that moves a victim when only the killer kills,
+// no phone rings and no teleport scares. Every real step is a step of the abstract game, so the distances are
+// lower bounds.
+class PatternDatabase {
+public:
+	static constexpr int kUnreachable = 0xff;
+
+	// whether the abstract game covers map, and its table is small enough to build
+	static bool covers(const Map & map) noexcept;
+
+	// next to the level file
+	static std::filesystem::path cachePathFor(const std::filesystem::path & mapFilePath)
+	{
+		return std::filesystem::path(mapFilePath).replace_extension(".pdb");
+	}
+
+	// loads the database of map cached at cachePath, or builds it and caches it there, unless the path is empty
+	PatternDatabase(const Map & map, const std::filesystem::path & cachePath);
+
+	// the fewest steps for the killer to kill the victim
+	int killDistance(const Pos & killer, const Pos & victim) const noexcept
+	{
+		return distances_[_cellIndex(killer) * cellCount_ + _cellIndex(victim)];
+	}
+
+	double buildSeconds() const noexcept { return buildSeconds_; }
+	bool loaded() const noexcept { return loaded_; }
+
+private:
+	static constexpr uint32_t kMagic = 0x42445053; // "SPDB"
+	static constexpr int kMaxBuiltCellCount = 256;
+
+	int _cellIndex(const Pos & pos) const noexcept { return pos.y * width_ + pos.x; }
+
+	static uint64_t _fingerprint(const Map & map) noexcept;
+
+	void _build(const Map & map);
+	bool _load(const std::filesystem::path & path, uint64_t fingerprint);
+	void _save(const std::filesystem::path & path, uint64_t fingerprint) const;
+
+	int width_;
+	int cellCount_;
+	std::vector<uint8_t> distances_; // killer cell major
+	double buildSeconds_ = 0;
+	bool loaded_ = false;
+};
@@ -1,26 +1,66 @@
 
 #include "Player.hpp"
 
+#include <bit>
 
 
 
-Player::Result Player::play(const Map & map, State & state, const Dir dir)
+
+template <uint16_t kMechanics, typename MapType>
+PlayerBase::Result BasicPlayer<kMechanics, MapType>::play(const Map & map, State & state, const Dir dir)
+{
+	WorkingState working(state);
+	const Result result = play(map, working, dir);
+	working.commit(state);
+	return result;
+}
+
+
+template <uint16_t kMechanics, typename MapType>
+PlayerBase::Result BasicPlayer<kMechanics, MapType>::play(const Map & map, WorkingState & state, const Dir dir)
 {
-	return Player(map, state)._step(dir);
+	return BasicPlayer(map, state)._step(dir);
 }
 
 
-Player::Player(const Map & map, State & state) :
+template <uint16_t kMechanics, typename MapType>
+PlayerBase::Result BasicPlayer<kMechanics, MapType>::apply(const Map & map, WorkingState & state, const Dir dir, UndoLog & undoLog)
+{
+	if constexpr (_has(Mechanics::Cops | Mechanics::Swats)) {
+		if (!state.hasDangerMap() && (state.countForType(Dude::Type::Cop) != 0 ||
+				state.countForType(Dude::Type::Swat) != 0)) {
+			// built before recording, so that undo brings it back for the next step
+			state.setDangerMap(BasicPlayer(map, state)._buildDangerMap());
+		}
+	}
+	state.startRecording(undoLog);
+	const Result result = play(map, state, dir);
+	state.stopRecording();
+	return result;
+}
+
+
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::undo(WorkingState & state, const UndoLog & undoLog)
+{
+	state.undo(undoLog);
+}
+
+
+template <uint16_t kMechanics, typename MapType>
+BasicPlayer<kMechanics, MapType>::BasicPlayer(const Map & map, WorkingState & state) :
 	map_(map),
 	state_(state)
 {
+	assert((map.mechanics & ~kMechanics) == 0);
 }
 
 
-bool Player::_aimedByCop(const Dude & cop) const noexcept
+template <uint16_t kMechanics, typename MapType>
+bool BasicPlayer<kMechanics, MapType>::_aimedByCop(const Dude & cop) const noexcept
 {
 	assert(cop.type == Dude::Type::Cop);
-	if (!state_.light) {
+	if (!state_.light()) {
 		// cops cannot aim when lights are off
 		return false;
 	}
@@ -28,75 +68,97 @@ bool Player::_aimedByCop(const Dude & cop) const noexcept
 		// cannot aim through any wall
 		return false;
 	}
-	return cop.pos + shiftForDir(cop.dir) == state_.killer.pos;
+	return cop.pos + shiftForDir(cop.dir) == state_.killer().pos;
 }
 
 
-bool Player::_aimedByAnyCop() const noexcept
+template <uint16_t kMechanics, typename MapType>
+bool BasicPlayer<kMechanics, MapType>::_aimedByAnyCop() const noexcept
 {
-	for (const Dude & dude : state_.dudes) {
-		if (dude.type == Dude::Type::Cop) {
-			if (_aimedByCop(dude)) {
-				return true;
-			}
-		}
+	if constexpr (!_has(Mechanics::Cops)) {
+		return false;
+	}
+	if (!state_.light() || state_.countForType(Dude::Type::Cop) == 0) {
+		return false;
 	}
-	return false;
+	return _dangerMap().cops[Zobrist::cellForPos(state_.killer().pos)];
 }
 
 
-bool Player::_aimedBySwat(const Dude & swat) const noexcept
+template <uint16_t kMechanics, typename MapType>
+bool BasicPlayer<kMechanics, MapType>::_aimedByAnySwat() const noexcept
 {
-	Pos pos = swat.pos;
+	if constexpr (!_has(Mechanics::Swats)) {
+		return false;
+	}
+	if (state_.countForType(Dude::Type::Swat) == 0) {
+		return false;
+	}
+	return _dangerMap().swats[Zobrist::cellForPos(state_.killer().pos)];
+}
 
-	while (true) {
-		if (map_.hasTallWall(pos, swat.dir)) {
-			break;
-		}
 
-		const Pos nextPos = pos + shiftForDir(swat.dir);
+template <uint16_t kMechanics, typename MapType>
+const DangerMap & BasicPlayer<kMechanics, MapType>::_dangerMap() const noexcept
+{
+	if (!state_.hasDangerMap()) {
+		state_.setDangerMap(_buildDangerMap());
+	}
+	return state_.dangerMap();
+}
 
-		if (nextPos == state_.killer.pos) {
-			return true;
-		}
 
-		{
-			const auto it = map_.findPhone(nextPos);
-			if (it != map_.phones.end()) {
-				break;
+template <uint16_t kMechanics, typename MapType>
+DangerMap BasicPlayer<kMechanics, MapType>::_buildDangerMap() const noexcept
+{
+	DangerMap dangerMap;
+
+	for (const Dude & dude : state_.dudes()) {
+		switch (dude.type) {
+		case Dude::Type::Cop:
+			// cannot aim through any wall
+			if (!map_.hasAnyWall(dude.pos, dude.dir)) {
+				dangerMap.cops.set(Zobrist::cellForPos(dude.pos + shiftForDir(dude.dir)));
 			}
-		}
+			break;
 
-		{
-			const auto it = state_.findDude(nextPos);
-			if (it != state_.dudes.end()) {
-				break;
+		case Dude::Type::Swat:
+			// swats shoot along the line until a tall wall, a phone or another dude
+			for (Pos pos = dude.pos; !map_.hasTallWall(pos, dude.dir);) {
+				const Pos nextPos = pos + shiftForDir(dude.dir);
+				if (map_.hasPhone(nextPos)) {
+					break;
+				}
+				const int cell = Zobrist::cellForPos(nextPos);
+				dangerMap.swatBlockers.set(cell);
+				if (state_.findDude(nextPos)) {
+					break;
+				}
+				dangerMap.swats.set(cell);
+				pos = nextPos;
 			}
-		}
+			break;
 
-		pos = nextPos;
+		case Dude::Type::Victim:
+		case Dude::Type::Cat:
+		case Dude::Type::Drop:
+			break;
+		}
 	}
 
-	return false;
+	return dangerMap;
 }
 
 
-bool Player::_aimedByAnySwat() const noexcept
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::_trySwitchLight(const Wall & wall, const Dir dir, Extra & extra) noexcept
 {
-	for (const Dude & dude : state_.dudes) {
-		if (dude.type == Dude::Type::Swat) {
-			if (_aimedBySwat(dude)) return true;
-		}
+	if constexpr (!_has(Mechanics::SwitchWalls)) {
+		return;
 	}
-	return false;
-}
-
-
-void Player::_trySwitchLight(const Wall & wall, const Dir dir, Extra & extra) noexcept
-{
 	if (wall.type == Wall::Type::Switch) {
 		if (dir == Dir::Up || dir == Dir::Left) {
-			state_.light = !state_.light;
+			state_.toggleLight();
 			if (wall.win) {
 				extra.win = Extra::Win::Switch;
 			}
@@ -105,17 +167,14 @@ void Player::_trySwitchLight(const Wall & wall, const Dir dir, Extra & extra) no
 }
 
 
-Player::Res Player::_go(const Pos & fromPos, const Dir dir, const bool portal) noexcept
+template <uint16_t kMechanics, typename MapType>
+PlayerBase::Res BasicPlayer<kMechanics, MapType>::_go(const Pos & fromPos, const Dir dir, const bool portal) noexcept
 {
-	std::array<Teleport, kMaxTeleportCount> visitedTeleports;
-	std::for_each(visitedTeleports.begin(), visitedTeleports.end(),
-			[] (Teleport & t) { t.pos = Pos::null(); });
-
-	const auto addTeleport = [&visitedTeleports] (const Teleport & teleport) {
-		const auto it = std::find_if(visitedTeleports.begin(), visitedTeleports.end(),
-				[] (const Teleport & t) { return t.pos == Pos::null(); });
-		assert(it != visitedTeleports.end());
-		*it = teleport;
+	visitedTeleportCount_ = 0;
+
+	const auto addTeleport = [this] (const Teleport & teleport) {
+		assert(visitedTeleportCount_ < kMaxTeleportCount);
+		visitedTeleports_[visitedTeleportCount_++] = teleport;
 	};
 
 	const Pos shift = shiftForDir(dir);
@@ -123,21 +182,25 @@ Player::Res Player::_go(const Pos & fromPos, const Dir dir, const bool portal) n
 	Pos pos = fromPos;
 
 	while (true) {
+		{
+			// skip cells that only dudes or mines could stop at
+			const int count = state_.freeCount(pos, dir, map_.slideLength(pos, dir));
+			pos = Pos{pos.x + shift.x * count, pos.y + shift.y * count};
+		}
+
 		const Pos nextPos = pos + shift;
 
-		const auto makeRes = [&pos, &nextPos, &visitedTeleports] (
-				const Bump & bump) -> Res {
+		const auto makeRes = [&pos, &nextPos] (const Bump & bump) -> Res {
 			return Res {
 				.bump = bump,
 				.pos = pos,
 				.target = nextPos,
-				.teleports = std::move(visitedTeleports),
 			};
 		};
 
 		if (map_.hasAnyWall(pos, dir)) {
-			const Wall & wall = map_.getWall(pos, dir);
-			if (state_.light && wall.type == Wall::Type::Zap) {
+			const Wall wall = map_.getWall(pos, dir);
+			if (_has(Mechanics::ZapWalls) && state_.light() && wall.type == Wall::Type::Zap) {
 				// bumped into electric wire wall
 				return makeRes(Bump::Death);
 			}
@@ -147,12 +210,10 @@ Player::Res Player::_go(const Pos & fromPos, const Dir dir, const bool portal) n
 		}
 
 		{
-			const auto it = state_.findDude(nextPos);
-			if (it != state_.dudes.end()) {
+			const Dude * const dude = state_.findDude(nextPos);
+			if (dude) {
 				// bumped into dude
-				const Dude & dude = *it;
-
-				if (dude.type == Dude::Type::Drop) {
+				if (_has(Mechanics::Drops) && dude->type == Dude::Type::Drop) {
 					return makeRes(Bump::Drop);
 				} else {
 					return makeRes(Bump::Dude);
@@ -160,62 +221,42 @@ Player::Res Player::_go(const Pos & fromPos, const Dir dir, const bool portal) n
 			}
 		}
 
-		{
-			const auto it = map_.findPhone(nextPos);
-			if (it != map_.phones.end()) {
-				return makeRes(Bump::Phone);
-			}
+		if (_has(Mechanics::Phones) && map_.hasPhone(nextPos)) {
+			return makeRes(Bump::Phone);
 		}
 
 		pos = nextPos;
 
-		{
-			const Trap trap = Trap{nextPos};
-			const auto it = std::find(map_.traps.begin(), map_.traps.end(), trap);
-			if (it != map_.traps.end()) {
-				// got into a trap
-				return makeRes(Bump::Death);
-			}
+		if (map_.hasTrap(nextPos)) {
+			// got into a trap
+			return makeRes(Bump::Death);
 		}
 
-		{
-			const Mine mine = Mine{nextPos};
-			const auto it = std::find(state_.mines.begin(), state_.mines.end(), mine);
-			if (it != state_.mines.end()) {
-				// stepped on a mine
-				state_.mines.erase(it);
-				return makeRes(Bump::Death);
-			}
+		if (_has(Mechanics::Mines) && state_.hasMine(nextPos)) {
+			// stepped on a mine
+			state_.removeMine(nextPos);
+			return makeRes(Bump::Death);
 		}
 
-		{
-			const auto it = std::find_if(map_.teleports.begin(), map_.teleports.end(),
-					[&pos] (const Teleport & teleport) {
-						return teleport.pos == pos;
-					});
-			if (it != map_.teleports.end()) {
-				const Teleport & teleport = *it;
-				const Teleport & otherTeleport = map_.getOtherTeleport(teleport);
-				addTeleport(teleport);
-				if (state_.findDude(otherTeleport.pos) != state_.dudes.end()) {
-					// other teleport is blocked
-				} else {
-					addTeleport(otherTeleport);
-					pos = otherTeleport.pos;
-				}
-				continue;
+		if (_has(Mechanics::Teleports) && map_.hasTeleport(pos)) {
+			const Teleport teleport = map_.getTeleport(pos);
+			const Teleport otherTeleport = map_.getOtherTeleport(teleport);
+			addTeleport(teleport);
+			if (state_.findDude(otherTeleport.pos)) {
+				// other teleport is blocked
+			} else {
+				addTeleport(otherTeleport);
+				pos = otherTeleport.pos;
 			}
+			continue;
 		}
 
-		if (portal && pos == map_.portal.pos) {
+		if (_has(Mechanics::Portal) && portal && pos == map_.portal.pos) {
 			return makeRes(Bump::Portal);
 		}
 
-		{
-			const auto it = map_.findGum(nextPos);
-			if (it != map_.gums.end()) {
-				return makeRes(Bump::Gum);
-			}
+		if (_has(Mechanics::Gums) && map_.hasGum(nextPos)) {
+			return makeRes(Bump::Gum);
 		}
 	}
 
@@ -223,27 +264,27 @@ Player::Res Player::_go(const Pos & fromPos, const Dir dir, const bool portal) n
 }
 
 
-void Player::_scare(const Pos & pos, Extra & extra) const noexcept
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::_scare(const Pos & pos, Extra & extra) const noexcept
 {
-	for (const Dir dir : kAllDirs) {
-		if (map_.hasTallWall(pos, dir)) {
-			continue;
-		}
+	// dirs without a tall wall, in the order of kAllDirs
+	for (uint8_t dirs = map_.cell(pos).openDirs(); dirs != 0; dirs &= dirs - 1) {
+		const Dir dir = Dir(std::countr_zero(dirs));
 
-		const auto it = state_.findDude(pos + shiftForDir(dir));
-		if (it == state_.dudes.end()) {
+		const Dude * const pdude = state_.findDude(pos + shiftForDir(dir));
+		if (!pdude) {
 			// no dude here
 			continue;
 		}
 
-		const Dude & dude = *it;
+		const Dude & dude = *pdude;
 		if (dude.type != Dude::Type::Victim && dude.type != Dude::Type::Cat) {
 			// can scare only victims and cats
 			continue;
 		}
 
 		if (dude.type == Dude::Type::Victim) {
-			if (!state_.light) {
+			if (!state_.light()) {
 				// cannot scare victim when lights are off, but cats still see in the dark
 				continue;
 			}
@@ -257,58 +298,53 @@ void Player::_scare(const Pos & pos, Extra & extra) const noexcept
 }
 
 
-void Player::_call(const Dude & who, const Phone & phone, Extra & extra) const noexcept
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::_call(const Dude & who, const Phone & phone, Extra & extra) const noexcept
 {
-	for (const Phone & otherPhone : map_.phones) {
+	for (int i = 0; i < int(map_.phones.size()); ++i) {
+		const Phone & otherPhone = map_.phones[i];
 		if (otherPhone.pos == phone.pos) continue;
 		if (otherPhone.color != phone.color) continue;
 
 		for (const Dir dir : kAllDirs) {
-			Pos pos = otherPhone.pos;
-
-			while (true) {
-				if (map_.hasTallWall(pos, dir)) {
-					break;
+			for (const Pos & pos : map_.phoneLine(i, dir)) {
+				const Dude * const pdude = state_.findDude(pos);
+				if (!pdude) {
+					continue;
 				}
 
-				const Pos nextPos = pos + shiftForDir(dir);
-
-				const auto it = state_.findDude(nextPos);
-				if (it != state_.dudes.end()) {
-					const Dude & dude = *it;
-					if (dude.pos != who.pos) {
-						switch (dude.type) {
-						case Dude::Type::Victim:
-						case Dude::Type::Cop:
-						case Dude::Type::Swat:
-							extra.called.push(Extra::Called {
-								.dude = dude,
-								.dir = oppositeDir(dir),
-							});
-							break;
-						case Dude::Type::Cat:
-							extra.scared.push(Extra::Scared {
-								.dude = dude,
-								.dir = dir,
-							});
-							break;
-						case Dude::Type::Drop:
-							break;
-						default:
-							assert(false);
-						}
+				const Dude & dude = *pdude;
+				if (dude.pos != who.pos) {
+					switch (dude.type) {
+					case Dude::Type::Victim:
+					case Dude::Type::Cop:
+					case Dude::Type::Swat:
+						extra.called.push(Extra::Called {
+							.dude = dude,
+							.dir = oppositeDir(dir),
+						});
+						break;
+					case Dude::Type::Cat:
+						extra.scared.push(Extra::Scared {
+							.dude = dude,
+							.dir = dir,
+						});
+						break;
+					case Dude::Type::Drop:
+						break;
+					default:
+						assert(false);
 					}
-					break;
 				}
-
-				pos = nextPos;
+				break;
 			}
 		}
 	}
 }
 
 
-void Player::_goDude(const Dude dude, const Dir dir, const bool called, Extra & extra) noexcept
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::_goDude(const Dude dude, const Dir dir, const bool called, Extra & extra) noexcept
 {
 	const Res res = _go(dude.pos, dir, false);
 
@@ -328,7 +364,7 @@ void Player::_goDude(const Dude dude, const Dir dir, const bool called, Extra &
 		if (res.bump == Bump::Death) {
 			extra.killed.push(target);
 		}
-		if (res.bump == Bump::Drop) {
+		if (_has(Mechanics::Drops) && res.bump == Bump::Drop) {
 			const Dude & drop = state_.getDude(res.target);
 			assert(drop.type == Dude::Type::Drop);
 			if (dirMatchesOrientation(dir, drop.orientation)) {
@@ -338,7 +374,7 @@ void Player::_goDude(const Dude dude, const Dir dir, const bool called, Extra &
 				});
 			}
 		}
-		if (res.bump == Bump::Phone) {
+		if (_has(Mechanics::Phones) && res.bump == Bump::Phone) {
 			// bumped into a phone, lets call it
 			if (dude.type != Dude::Type::Cat) { // cats cannot call
 				if (!called) { // cannot call to myself
@@ -347,7 +383,7 @@ void Player::_goDude(const Dude dude, const Dir dir, const bool called, Extra &
 			}
 		}
 		if (res.bump == Bump::Wall) {
-			const Wall & wall = map_.getWall(target.pos, dir);
+			const Wall wall = map_.getWall(target.pos, dir);
 			_trySwitchLight(wall, dir, extra);
 			if (wall.type == Wall::Type::Escape) {
 				if (dude.type == Dude::Type::Victim || dude.type == Dude::Type::Cat) {
@@ -364,19 +400,15 @@ void Player::_goDude(const Dude dude, const Dir dir, const bool called, Extra &
 }
 
 
-void Player::_kill(const Dude dude, Extra & extra, std::queue<Extra::Scared> & scared) noexcept
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::_kill(const Dude dude, Extra & extra, RingBuffer<Extra::Scared, kMaxDudeCount * 4> & scared) noexcept
 {
-	{
-		const auto it = state_.findDude(dude.pos);
-		assert(it != state_.dudes.end());
-		const Dude & dude = *it;
-		if (dude.type == Dude::Type::Cat) {
-			extra.fail = Extra::Fail::Catality;
-		}
-		state_.dudes.erase(it);
+	if (state_.getDude(dude.pos).type == Dude::Type::Cat) {
+		extra.fail = Extra::Fail::Catality;
 	}
+	state_.removeDude(dude.pos);
 
-	removeFromQueue<Extra::Scared>(scared, [&dude] (const Extra::Scared & s) -> bool {
+	scared.removeIf([&dude] (const Extra::Scared & s) -> bool {
 		return s.dude.pos == dude.pos;
 	});
 
@@ -384,154 +416,173 @@ void Player::_kill(const Dude dude, Extra & extra, std::queue<Extra::Scared> & s
 }
 
 
-void Player::_processExtra(Extra & extra) noexcept
+template <uint16_t kMechanics, typename MapType>
+void BasicPlayer<kMechanics, MapType>::_processExtra(Extra & extra) noexcept
 {
-	// check if we stopped in front of a cop
-	if (_aimedByAnyCop()) {
-		extra.fail = Extra::Fail::Cop;
-		return;
-	}
+	// every round handles the events the previous one caused, until nothing happens anymore;
+	// the drained queues of a round are reused for the round after the next one
+	Extra nextExtra;
+	Extra * current = &extra;
+	Extra * next = &nextExtra;
+
+	// a later round overrides the outcome of an earlier one
+	Extra::Fail fail = Extra::Fail::None;
+	Extra::Win win = Extra::Win::None;
+	const auto fold = [&fail, &win] (const Extra & e) {
+		if (e.fail != Extra::Fail::None) fail = e.fail;
+		if (e.win != Extra::Win::None) win = e.win;
+	};
 
-	// check if we are on a line sight of a swat
-	if (_aimedByAnySwat()) {
-		extra.fail = Extra::Fail::Swat;
-		return;
-	}
+	while (true) {
+		fold(*current);
 
-	if (extra.killed.empty() && extra.dropped.empty() && extra.scared.empty() &&
-			extra.called.empty()) {
-		return;
-	}
+		// check if we stopped in front of a cop
+		if (_aimedByAnyCop()) {
+			fail = Extra::Fail::Cop;
+			break;
+		}
 
-	Extra nextExtra;
+		// check if we are on a line sight of a swat
+		if (_aimedByAnySwat()) {
+			fail = Extra::Fail::Swat;
+			break;
+		}
 
-	while (!extra.killed.empty()) {
-		const Dude dude = extra.killed.front();
-		extra.killed.pop();
-		_kill(dude, nextExtra, extra.scared);
-	}
+		if (current->killed.empty() && current->dropped.empty() && current->scared.empty() &&
+				current->called.empty()) {
+			break;
+		}
 
-	while (!extra.dropped.empty()) {
-		const Extra::Dropped dropped = extra.dropped.front();
-		extra.dropped.pop();
+		next->fail = Extra::Fail::None;
+		next->win = Extra::Win::None;
 
-		if (map_.hasAnyWall(dropped.drop.pos, dropped.dir)) {
-			// cannot drop onto the wall
-			continue;
+		while (!current->killed.empty()) {
+			const Dude dude = current->killed.front();
+			current->killed.pop();
+			_kill(dude, *next, current->scared);
 		}
 
-		const Pos dropPos = dropped.drop.pos + shiftForDir(dropped.dir);
-		const auto it = state_.findDude(dropPos);
-		if (it != state_.dudes.end()) {
-			const Dude & dude = *it;
-			if (dude.type == Dude::Type::Drop) {
-				// cannot drop onto another drop
+		while (_has(Mechanics::Drops) && !current->dropped.empty()) {
+			const Extra::Dropped dropped = current->dropped.front();
+			current->dropped.pop();
+
+			if (map_.hasAnyWall(dropped.drop.pos, dropped.dir)) {
+				// cannot drop onto the wall
 				continue;
 			}
-			_kill(dude, nextExtra, extra.scared);
-		}
 
-		if (dropPos == state_.killer.pos) {
-			extra.fail = Extra::Fail::Drop;
-			continue;
-		}
+			const Pos dropPos = dropped.drop.pos + shiftForDir(dropped.dir);
+			const Dude * const pdude = state_.findDude(dropPos);
+			if (pdude) {
+				const Dude & dude = *pdude;
+				if (dude.type == Dude::Type::Drop) {
+					// cannot drop onto another drop
+					continue;
+				}
+				_kill(dude, *next, current->scared);
+			}
 
-		state_.moveDude(dropped.drop, Dude {
-			.type = Dude::Type::Drop,
-			.pos = dropPos,
-			.orientation = Orientation::Down,
-		});
-	}
+			if (dropPos == state_.killer().pos) {
+				fail = Extra::Fail::Drop;
+				continue;
+			}
 
-	while (!extra.scared.empty()) {
-		const Extra::Scared scared = extra.scared.front();
-		extra.scared.pop();
-		removeFromQueue<Extra::Called>(extra.called, [&scared] (const Extra::Called & called) {
-			return called.dude.pos == scared.dude.pos;
-		});
-		_goDude(scared.dude, scared.dir, false, nextExtra);
-	}
+			state_.moveDude(dropped.drop, Dude {
+				.type = Dude::Type::Drop,
+				.pos = dropPos,
+				.orientation = Orientation::Down,
+			});
+		}
 
-	while (!extra.called.empty()) {
-		const Extra::Called called = extra.called.front();
-		extra.called.pop();
-		_goDude(called.dude, called.dir, true, nextExtra);
-	}
+		while (!current->scared.empty()) {
+			const Extra::Scared scared = current->scared.front();
+			current->scared.pop();
+			current->called.removeIf([&scared] (const Extra::Called & called) {
+				return called.dude.pos == scared.dude.pos;
+			});
+			_goDude(scared.dude, scared.dir, false, *next);
+		}
 
-	_processExtra(nextExtra);
+		while (!current->called.empty()) {
+			const Extra::Called called = current->called.front();
+			current->called.pop();
+			_goDude(called.dude, called.dir, true, *next);
+		}
 
-	if (nextExtra.fail != Extra::Fail::None) {
-		extra.fail = nextExtra.fail;
-	}
-	if (nextExtra.win != Extra::Win::None) {
-		extra.win = nextExtra.win;
+		std::swap(current, next);
 	}
+
+	extra.fail = fail;
+	extra.win = win;
 }
 
 
-Player::Result Player::_step(const Dir dir)
+template <uint16_t kMechanics, typename MapType>
+PlayerBase::Result BasicPlayer<kMechanics, MapType>::_step(const Dir dir)
 {
 	bool fail = false;
 	bool win = false;
 
-	const Res res = _go(state_.killer.pos, dir, !state_.hasVictims());
+	const Res res = _go(state_.killer().pos, dir, !state_.hasVictims());
 
 	Extra extra;
 
-	for (const Teleport & teleport : res.teleports) {
-		if (teleport.pos == Pos::null()) break;
-		if (teleport.pos != res.pos) {
-			_scare(teleport.pos, extra);
+	if constexpr (_has(Mechanics::Teleports)) {
+		for (int i = 0; i < visitedTeleportCount_; ++i) {
+			const Teleport & teleport = visitedTeleports_[i];
+			if (teleport.pos != res.pos) {
+				_scare(teleport.pos, extra);
+			}
 		}
 	}
 
 	switch (res.bump) {
 	case Bump::Gum : {
-		state_.killer.pos = res.pos;
-		_scare(state_.killer.pos, extra);
+		state_.setKillerPos(res.pos);
+		_scare(state_.killer().pos, extra);
 	}
 		break;
 
 	case Bump::Wall: {
-		const Wall & wall = map_.getWall(res.pos, dir);
+		const Wall wall = map_.getWall(res.pos, dir);
 		_trySwitchLight(wall, dir, extra);
 
-		state_.killer.pos = res.pos;
-		_scare(state_.killer.pos, extra);
+		state_.setKillerPos(res.pos);
+		_scare(state_.killer().pos, extra);
 	}
 		break;
 
 	case Bump::Dude: {
-		state_.killer.pos = res.pos;
+		state_.setKillerPos(res.pos);
 
 		const Dude dude = state_.getDude(res.target);
 
-		if (dude.type == Dude::Type::Cop) {
+		if (_has(Mechanics::Cops) && dude.type == Dude::Type::Cop) {
 			if (_aimedByCop(dude)) {
 				fail = true;
 				break;
 			}
 		}
 
-		if (dude.type == Dude::Type::Swat) {
-			if (state_.light) {
+		if (_has(Mechanics::Swats) && dude.type == Dude::Type::Swat) {
+			if (state_.light()) {
 				// swat kills you instantly when lights are on
 				fail = true;
 				break;
 			}
 		}
 
-		_scare(state_.killer.pos, extra);
+		_scare(state_.killer().pos, extra);
 		extra.killed.push(dude);
 	}
 		break;
 
 	case Bump::Drop: {
-		state_.killer.pos = res.pos;
+		state_.setKillerPos(res.pos);
 
 		const Dude drop = state_.getDude(res.target);
 
-		_scare(state_.killer.pos, extra);
+		_scare(state_.killer().pos, extra);
 		if (dirMatchesOrientation(dir, drop.orientation)) {
 			extra.dropped.push(Extra::Dropped {
 				.drop = drop,
@@ -542,12 +593,12 @@ Player::Result Player::_step(const Dir dir)
 		break;
 
 	case Bump::Phone: {
-		state_.killer.pos = res.pos;
+		state_.setKillerPos(res.pos);
 
-		const Phone & phone = map_.getPhone(res.target);
+		const Phone phone = map_.getPhone(res.target);
 
-		_scare(state_.killer.pos, extra);
-		_call(Dude{.type = Dude::Type::Victim, .pos = state_.killer.pos}, phone, extra);
+		_scare(state_.killer().pos, extra);
+		_call(Dude{.type = Dude::Type::Victim, .pos = state_.killer().pos}, phone, extra);
 	}
 		break;
 
@@ -556,7 +607,7 @@ Player::Result Player::_step(const Dir dir)
 		break;
 
 	case Bump::Portal:
-		state_.killer.pos = res.pos;
+		state_.setKillerPos(res.pos);
 		win = true;
 		break;
 	}
@@ -587,7 +638,7 @@ Player::Result Player::_step(const Dir dir)
 
 	if (!win) {
 		if (!state_.hasVictims()) {
-			if (map_.portal.pos == Pos::null()) {
+			if (!_has(Mechanics::Portal) || map_.portal.pos == Pos::null()) {
 				return Result::Win;
 			}
 		}
@@ -595,3 +646,14 @@ Player::Result Player::_step(const Dir dir)
 
 	return Result::None;
 }
+
+
+
+template class BasicPlayer<kPlayerMechanics[0]>;
+template class BasicPlayer<kPlayerMechanics[1]>;
+template class BasicPlayer<kPlayerMechanics[2]>;
+static_assert(kPlayerMechanics.size() == 3);
+
+#ifdef SLAYAWAYCAMP_LEVEL_HEADER
+template class BasicPlayer<GeneratedLevel::kMechanics, FixedMap<GeneratedLevel>>;
+#endif
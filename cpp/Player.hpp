@@ -1,14 +1,17 @@
 
 #pragma once
 
-#include <queue>
+#include <type_traits>
 
 #include "Map.hpp"
+#include "RingBuffer.hpp"
+#include "WorkingState.hpp"
 
 
 
 
-class Player {
+// What every BasicPlayer shares, whatever mechanics it plays.
+class PlayerBase {
 public:
 	enum class Result {
 		None,
@@ -16,9 +19,7 @@ public:
 		Win,
 	};
 
-	static Result play(const Map & map, State & state, Dir dir);
-
-private:
+protected:
 	enum class Bump {
 		Wall,
 		Dude,
@@ -33,7 +34,6 @@ private:
 		Bump bump;
 		Pos pos;
 		Pos target;
-		std::array<Teleport, kMaxTeleportCount> teleports;
 	};
 
 	struct Extra {
@@ -55,32 +55,105 @@ private:
 		enum class Win {
 			None, Switch
 		};
-		std::queue<Dude> killed;
-		std::queue<Dropped> dropped;
-		std::queue<Scared> scared;
-		std::queue<Called> called;
+		// each dude is killed or dropped at most once per round, but can be scared or called from every side
+		RingBuffer<Dude, kMaxDudeCount> killed;
+		RingBuffer<Dropped, kMaxDudeCount> dropped;
+		RingBuffer<Scared, kMaxDudeCount * 4> scared;
+		RingBuffer<Called, kMaxDudeCount * 4> called;
 		Fail fail = Fail::None;
 		Win win = Win::None;
 	};
+};
 
-	Player(const Map & map, State & state);
+
+
+
+// Plays the steps of maps that use no mechanics beyond kMechanics, the unused ones are compiled out.
+// MapType is Map, or a FixedMap of the one level the player is compiled for.
+template <uint16_t kMechanics, typename MapType = Map>
+class BasicPlayer : public PlayerBase {
+public:
+	static Result play(const Map & map, State & state, Dir dir);
+	static Result play(const Map & map, WorkingState & state, Dir dir);
+
+	// plays a step in place, recording what undo() needs to bring the state back
+	static Result apply(const Map & map, WorkingState & state, Dir dir, UndoLog & undoLog);
+	static void undo(WorkingState & state, const UndoLog & undoLog);
+
+private:
+	static constexpr bool _has(const uint16_t mechanics) noexcept { return (kMechanics & mechanics) != 0; }
+
+	BasicPlayer(const Map & map, WorkingState & state);
 
 	Result _step(Dir dir);
 
 	bool _aimedByCop(const Dude & cop) const noexcept;
 	bool _aimedByAnyCop() const noexcept;
-	bool _aimedBySwat(const Dude & swat) const noexcept;
 	bool _aimedByAnySwat() const noexcept;
+	const DangerMap & _dangerMap() const noexcept;
+	DangerMap _buildDangerMap() const noexcept;
 
 	void _trySwitchLight(const Wall & wall, Dir dir, Extra & extra) noexcept;
 	Res _go(const Pos & fromPos, Dir dir, bool portal) noexcept;
 	void _scare(const Pos & pos, Extra & extra) const noexcept;
 	void _call(const Dude & who, const Phone & phone, Extra & extra) const noexcept;
 	void _goDude(Dude dude, Dir dir, bool called, Extra & extra) noexcept;
-	void _kill(Dude dude, Extra & extra, std::queue<Extra::Scared> & scared) noexcept;
+	void _kill(Dude dude, Extra & extra, RingBuffer<Extra::Scared, kMaxDudeCount * 4> & scared) noexcept;
 	void _processExtra(Extra & extra) noexcept;
 
-	const Map & map_;
+	std::conditional_t<std::is_same_v<MapType, Map>, const Map &, const MapType> map_;
+
+	WorkingState & state_;
 
-	State & state_;
+	// teleports passed by the last _go, in order
+	std::array<Teleport, kMaxTeleportCount> visitedTeleports_;
+	int visitedTeleportCount_ = 0;
 };
+
+
+
+
+// The mechanic sets Player is instantiated for, from the fewest mechanics to all of them.
+// Maps are played by the first set that covers them. Only the sets playerbench shows paying off are kept;
+// summed over the levels of each set, generic player against specialized one:
+// - portal only, 50 levels: 29.6 ms against 25.8 ms
+// - drops and portal, 21 levels: 25.0 ms against 22.1 ms
+// - the 129 others, played with all mechanics: 212.0 ms against 210.0 ms, where narrower splits were within noise
+inline static constexpr std::array<uint16_t, 3> kPlayerMechanics = {
+	Mechanics::Portal,
+	Mechanics::Drops | Mechanics::Portal,
+	Mechanics::kAll,
+};
+
+static_assert(kPlayerMechanics.back() == Mechanics::kAll);
+
+
+// plays anything, for the callers that are not worth specializing
+using Player = BasicPlayer<Mechanics::kAll>;
+
+
+// calls func.template operator()<kMechanics>() once, with the fewest mechanics that cover the given ones
+template <int kIndex = 0, typename Func>
+inline void withPlayerMechanics(const uint16_t mechanics, Func && func)
+{
+	static constexpr uint16_t kMechanics = kPlayerMechanics[kIndex];
+	if constexpr (kIndex + 1 == int(kPlayerMechanics.size())) {
+		func.template operator()<kMechanics>();
+	} else {
+		if ((mechanics & ~kMechanics) == 0) {
+			func.template operator()<kMechanics>();
+		} else {
+			withPlayerMechanics<kIndex + 1>(mechanics, func);
+		}
+	}
+}
+
+
+
+
+#ifdef SLAYAWAYCAMP_LEVEL_HEADER
+#include SLAYAWAYCAMP_LEVEL_HEADER
+
+// the player of the level the binary is built for, see FixedMap
+using LevelPlayer = BasicPlayer<GeneratedLevel::kMechanics, FixedMap<GeneratedLevel>>;
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cassert>
+#include <type_traits>
+
+
+
+
+// Fixed-capacity FIFO queue kept inline, for the event queues of a single step.
+// Items are left uninitialized until pushed, so an empty buffer costs nothing to create.
+template <typename T, int N>
+class RingBuffer {
+public:
+	static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+	static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+	RingBuffer() noexcept {}
+	~RingBuffer() {}
+
+	bool empty() const noexcept { return size_ == 0; }
+	int size() const noexcept { return size_; }
+
+	const T & front() const noexcept
+	{
+		assert(size_ > 0);
+		return items_[head_];
+	}
+
+	void push(const T & item) noexcept
+	{
+		assert(size_ < N);
+		items_[(head_ + size_) & (N - 1)] = item;
+		size_++;
+	}
+
+	void pop() noexcept
+	{
+		assert(size_ > 0);
+		head_ = (head_ + 1) & (N - 1);
+		size_--;
+	}
+
+	// drops matching items in place, keeping the order of the rest
+	template <typename Op>
+	void removeIf(const Op & op) noexcept
+	{
+		int kept = 0;
+		for (int i = 0; i < size_; ++i) {
+			const T & item = items_[(head_ + i) & (N - 1)];
+			if (!op(item)) {
+				items_[(head_ + kept) & (N - 1)] = item;
+				kept++;
+			}
+		}
+		size_ = kept;
+	}
+
+private:
+	union {
+		T items_[N];
+	};
+	int head_ = 0;
+	int size_ = 0;
+};
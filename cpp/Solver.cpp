@@ -1,125 +1,130 @@
 
 #include "Solver.hpp"
 
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <optional>
+
 #include "Debug.hpp" // IWYU pragma: keep
-#include "Player.hpp"
+#include "Heuristic.hpp"
 
 
 
 
-void Solver::solve(const Map & map, const SolutionCallback & cb)
+Solver::Stats Solver::solve(const Map & map, const SolutionCallback & cb)
 {
-	Solver(map, cb);
+	return Solver(map, Config{}, cb).stats_;
 }
 
 
-Solver::Solver(const Map & map, const SolutionCallback & cb)
+Solver::Stats Solver::solve(const Map & map, const Config & config, const SolutionCallback & cb)
 {
-	{
-		const MoveRes init = _addMove(Move {
-			.previousId = -1,
-			.state = map.state,
-		});
-		assert(!init.same);
-		moveIdsLeft_.push(init.id);
-	}
-
-	while (!moveIdsLeft_.empty()) {
-		const int currentMoveId = moveIdsLeft_.front();
-		moveIdsLeft_.pop();
-
-		const int currentDistance = _moveDistance(currentMoveId);
-		const bool isLastTurn = map.info.turns != -1 && currentDistance == map.info.turns - 1;
-
-		for (const Dir dir : kAllDirs) {
-#ifdef ENABLE_DEBUG
-			if (currentMoveId == kDebugMoveId && dir == kDebugMoveDir) {
-				int breakhere = 1;
-			}
-#endif
-
-			State state = moves_[currentMoveId].state;
-
-			const Player::Result result = Player::play(map, state, dir);
-
-			if (result == Player::Result::Fail) {
-				continue;
-			}
-
-			const MoveRes moveRes = _addMove(Move {
-				.dir = dir,
-				.previousId = currentMoveId,
-				.state = std::move(state),
-			});
+	return Solver(map, config, cb).stats_;
+}
 
-			if (!moveRes.same) {
-				if (result == Player::Result::Win) {
-					winMoveIds_.push_back(moveRes.id);
-				} else {
-					if (!isLastTurn) {
-						moveIdsLeft_.push(moveRes.id);
-					}
-				}
-			}
 
-#ifdef ENABLE_DEBUG
-			const std::vector<int> steps = _getSteps(moveRes.id);
-			const std::string stepsString = _stepsToString(steps);
+Solver::Solver(const Map & map, const Config & config, const SolutionCallback & cb) :
+	map_(map),
+	cb_(cb),
+	threadCount_(std::max(1, config.threadCount)),
+	allocationCount_(config.allocationCount),
+	packer_(map),
+	moveIdForState_(threadCount_ == 1 ? 1 : threadCount_ * kTablesPerThread),
+	moves_(packer_.wordCount()),
+	threadPool_(threadCount_)
+{
+	const int startId = _addStartMove();
 
-			if (!kDebugOnlyExpectedSteps || kDebugExpectedSteps.starts_with(stepsString)) {
-				printf("move: from: %d to: %s same: %d id: %d\n", currentMoveId, nameForDir(dir).data(), moveRes.same, moveRes.id);
-				if (!moveRes.same) {
-					const Move & m = moves_[moveRes.id];
-					printf("    killer: %d %d\n", m.state.killer.pos.x, m.state.killer.pos.y);
-					for (const Dude & d : m.state.dudes) {
-						printf("    dude: %d %d - %s", d.pos.x, d.pos.y, nameForDudeType(d.type).data());
-						switch (d.type) {
-						case Dude::Type::Victim:
-						case Dude::Type::Cat:
-							break;
-						case Dude::Type::Cop:
-						case Dude::Type::Swat:
-							printf(" (%s)", nameForDir(d.dir).data());
-							break;
-						case Dude::Type::Drop:
-							printf(" (%s)", nameForOrientation(d.orientation).data());
-							break;
-						}
-						printf("\n");
-					}
-				}
-			}
-			fflush(stdout);
+	// the player is picked once for the whole search
+	const auto search = [this, &config, startId] <typename PlayerType> () {
+		if (config.search == Search::Breadth) {
+			_searchBreadthFirst<PlayerType>(startId);
+			return;
+		}
+		if (config.search == Search::Distributed) {
+			_searchDistributed<PlayerType>();
+			return;
+		}
+		if (config.search == Search::Frontier) {
+			_searchFrontier<PlayerType>(config.transpositionBits);
+			return;
+		}
 
-			const Move & m = moves_[moveRes.id];
-			if (stepsString == kDebugExpectedSteps) {
-				int b = 1;
-			}
-#endif
+		const Heuristic heuristic(map_, config.patternDatabase);
+		switch (config.search) {
+		case Search::Breadth:
+		case Search::Distributed:
+		case Search::Frontier:
+			break;
+		case Search::AStar:
+			_searchBestFirst<PlayerType>(startId, heuristic, 1, std::numeric_limits<int>::max());
+			break;
+		case Search::Beam:
+			_searchBeam<PlayerType>(startId, heuristic, config.statesPerDepth, config.beamPasses);
+			break;
+		case Search::WeightedAStar:
+			_searchBestFirst<PlayerType>(startId, heuristic, config.weight, config.statesPerDepth);
+			break;
+		case Search::IdaStar:
+			_searchIterativeDeepening<PlayerType>(startId, heuristic, config.transpositionBits);
+			break;
+		}
+		stats_.databaseLookupCount = heuristic.lookupCount();
+		stats_.databaseRaiseCount = heuristic.raiseCount();
+		if (config.patternDatabase) {
+			printf("pattern database: lookups: %lld raised: %lld\n", (long long)heuristic.lookupCount(),
+					(long long)heuristic.raiseCount());
 		}
+	};
+	bool searched = false;
+#ifdef SLAYAWAYCAMP_LEVEL_HEADER
+	// a binary built for the level plays it with the player compiled for it
+	if (!config.genericPlayer && FixedMap<GeneratedLevel>::matches(map)) {
+		printf("player: %s\n", GeneratedLevel::kShortName.data());
+		search.template operator()<LevelPlayer>();
+		searched = true;
+	}
+#endif
+	if (!searched) {
+		withPlayerMechanics(map.mechanics, [&search] <uint16_t kMechanics> () {
+			search.template operator()<BasicPlayer<kMechanics>>();
+		});
 	}
 
 	std::sort(winMoveIds_.begin(), winMoveIds_.end(), [this] (const int a, const int b) {
-		return _moveDistance(a) < _moveDistance(b);
+		return moves_.depth(a) < moves_.depth(b);
 	});
 
-	printf("moves: %d wins: %d\n", int(moves_.size()), int(winMoveIds_.size()));
+	// searches keeping their states out of moves_ count them themselves
+	stats_.moveCount = std::max(stats_.moveCount, moves_.size());
 
-	for (const int winMoveId : winMoveIds_) {
-		std::vector<int> seq;
-		for (int id = winMoveId; id != -1;) {
-			seq.push_back(id);
-			id = moves_[id].previousId;
-			if (moves_[id].previousId == -1) break;
+	printf("moves: %d wins: %d\n", moves_.size(), solutionCount_ + int(winMoveIds_.size()));
+
+	{
+		int64_t size = 0;
+		int64_t capacity = 0;
+		double probes = 0;
+		for (const StateTable & table : moveIdForState_) {
+			size += table.size();
+			capacity += table.capacity();
+			probes += table.averageProbeLength() * table.size();
 		}
-		std::reverse(seq.begin(), seq.end());
+		printf("tables: %d load: %.3f probes: %.3f\n", int(moveIdForState_.size()),
+				double(size) / capacity, probes / std::max<int64_t>(1, size));
+	}
+
+	// breadth-first search reports its wins at the end, shortest first
+	for (const int winMoveId : winMoveIds_) {
+		std::vector<int> seq = _getSteps(winMoveId);
 
 		if (kShowStepsVerbosity > 0) {
-			printf("win move: %d (steps: %d)\n", winMoveId, _moveDistance(winMoveId));
+			printf("win move: %d (steps: %d)\n", winMoveId, moves_.depth(winMoveId));
 			if (kShowStepsVerbosity > 1) {
 				int stepIndex = 0;
 				for (const int id : seq) {
-					const Dir dir = moves_[id].dir;
+					const Dir dir = moves_.dir(id);
 					if (kShowStepsCount == -1 || stepIndex < kShowStepsCount) {
 						printf("    % 4d %s\n", id, nameForDir(dir).data());
 					}
@@ -132,22 +137,66 @@ Solver::Solver(const Map & map, const SolutionCallback & cb)
 			.steps = [this, &seq] () -> Steps {
 				Steps steps;
 				for (const int id : seq) {
-					steps.push_back(moves_[id].dir);
+					steps.push_back(moves_.dir(id));
 				}
 				return steps;
 			}(),
+			.lowerBound = moves_.depth(winMoveIds_.front()),
 		});
 	}
 }
 
 
+int Solver::_addStartMove()
+{
+	std::vector<PackedWord> words(packer_.wordCount());
+	packer_.pack(map_.state, words.data());
+	const int id = moves_.add(-1, kNullDir, words.data());
+	const uint64_t hash = packer_.hash(words.data());
+	moveIdForState_[_tableIndexForHash(hash)].insert(hash, id);
+	return id;
+}
+
+
+void Solver::_clearMoves()
+{
+	moves_.clear();
+	for (StateTable & table : moveIdForState_) {
+		table = StateTable();
+	}
+	winMoveIds_.clear();
+}
+
+
+Steps Solver::_stepsForMove(const int moveId) const
+{
+	Steps steps;
+	for (const int id : _getSteps(moveId)) {
+		steps.push_back(moves_.dir(id));
+	}
+	return steps;
+}
+
+
+void Solver::_reportSolution(Steps && steps, const int lowerBound)
+{
+	// right away, as the moves can be cleared before the search ends
+	printf("solution: steps: %d lower bound: %d\n", int(steps.size()), lowerBound);
+	solutionCount_++;
+	cb_(Solution {
+		.steps = std::move(steps),
+		.lowerBound = lowerBound,
+	});
+}
+
+
 std::vector<int> Solver::_getSteps(const int moveId) const noexcept
 {
 	std::vector<int> steps;
 	for (int id = moveId; id != -1;) {
 		steps.push_back(id);
-		id = moves_[id].previousId;
-		if (moves_[id].previousId == -1) break;
+		id = moves_.previousId(id);
+		if (moves_.previousId(id) == -1) break;
 	}
 	std::reverse(steps.begin(), steps.end());
 	return steps;
@@ -158,36 +207,1011 @@ std::string Solver::_stepsToString(const std::vector<int> & steps) const noexcep
 {
 	std::string s;
 	for (const int id : steps) {
-		const Dir dir = moves_[id].dir;
+		const Dir dir = moves_.dir(id);
 		s += shortNameForDir(dir);
 	}
 	return s;
 }
 
 
-Solver::MoveRes Solver::_addMove(Move && move)
+int Solver::_findMove(const StateTable & table, const PackedWord * const words) const noexcept
 {
-	const auto it = moveIdForState_.find(move.state);
-	if (it != moveIdForState_.end()) {
-		const int oldMoveId = it->second;
-		const int oldMoveDistance = _moveDistance(oldMoveId);
-		const int newMoveDistance = _moveDistance(move.previousId) + 1;
-		if (newMoveDistance < oldMoveDistance) {
-			Move & oldMove = moves_[oldMoveId];
-			oldMove.previousId = move.previousId;
-			oldMove.dir = move.dir;
+	return table.find(packer_.hash(words), [this, words] (const int id) {
+		return packer_.equals(moves_.packedState(id), words);
+	});
+}
+
+
+template <typename PlayerType>
+void Solver::_searchBreadthFirst(const int startId)
+{
+	std::vector<int> layer = {startId};
+	for (int distance = 0; !layer.empty(); ++distance) {
+		const bool isLastTurn = map_.info.turns != -1 && distance == map_.info.turns - 1;
+		stats_.expandedCount += layer.size();
+		layer = _expandLayer<PlayerType>(layer, isLastTurn);
+	}
+}
+
+
+template <typename PlayerType, typename HeuristicType>
+void Solver::_searchBestFirst(const int startId, const HeuristicType & heuristic, const double weight,
+		const int statesPerDepth)
+{
+	// A* on one thread over the same moves and tables. States wait in a bucket per depth plus weighted estimate,
+	// taken last in first out, which tries the deepest of equally good states first. Past the first win,
+	// only states that could still win in fewer steps go on, until none is left.
+	// With a weight of one and no cap on the states of a depth, that first win is already the shortest.
+
+	constexpr int kNone = std::numeric_limits<int>::max();
+
+	struct Entry {
+		int id;
+		int depth; // stale once the move is reached by a shorter path
+		int estimate;
+		bool win;
+	};
+
+	std::vector<std::vector<Entry>> buckets;
+	int bucketIndex = 0;
+	// entries by depth plus estimate, which bounds the wins still in the queue
+	std::vector<int> queuedCounts;
+	const auto push = [&buckets, &bucketIndex, &queuedCounts, weight] (const Entry & entry) {
+		const int f = entry.depth + int(weight * entry.estimate);
+		if (f >= int(buckets.size())) {
+			buckets.resize(f + 1);
 		}
-		return MoveRes {
-			.id = oldMoveId,
-			.same = true,
-		};
-	} else {
-		const int id = moves_.size();
-		moveIdForState_[move.state] = id;
-		moves_.push_back(std::move(move));
-		return MoveRes {
-			.id = id,
-			.same = false,
+		buckets[f].push_back(entry);
+		// only an estimate dropping by more than a step goes back to an earlier bucket
+		bucketIndex = std::min(bucketIndex, f);
+		if (entry.depth + entry.estimate >= int(queuedCounts.size())) {
+			queuedCounts.resize(entry.depth + entry.estimate + 1);
+		}
+		queuedCounts[entry.depth + entry.estimate]++;
+	};
+
+	std::vector<int> storedCounts;
+	int bestId = -1;
+	int bestDepth = kNone;
+	int droppedBound = kNone; // fewest steps a win through a state dropped for the cap takes
+	const auto lowerBound = [&queuedCounts, &bestDepth, &droppedBound] () -> int {
+		const auto queued = std::find_if(queuedCounts.begin(), queuedCounts.end(), [] (const int count) {
+			return count != 0;
+		});
+		const int queuedBound = queued == queuedCounts.end() ? kNone : int(queued - queuedCounts.begin());
+		return std::min({bestDepth, droppedBound, queuedBound});
+	};
+
+	const int wordCount = packer_.wordCount();
+	WorkingState working;
+	UndoLog undoLog;
+	State state;
+	std::array<Player::Result, kAllDirs.size()> results;
+	std::array<int, kAllDirs.size()> estimates;
+	std::vector<PackedWord> childWords(kAllDirs.size() * wordCount);
+
+	packer_.unpack(moves_.packedState(startId), state);
+	push(Entry {.id = startId, .depth = 0, .estimate = heuristic.estimate(state), .win = false});
+
+	while (bucketIndex < int(buckets.size())) {
+		if (buckets[bucketIndex].empty()) {
+			bucketIndex++;
+			continue;
+		}
+		const Entry entry = buckets[bucketIndex].back();
+		buckets[bucketIndex].pop_back();
+		if (entry.depth != moves_.depth(entry.id) || entry.depth + entry.estimate >= bestDepth) {
+			queuedCounts[entry.depth + entry.estimate]--;
+			continue;
+		}
+		if (entry.win) {
+			queuedCounts[entry.depth + entry.estimate]--;
+			bestId = entry.id;
+			bestDepth = entry.depth;
+			const int bound = lowerBound();
+			_reportSolution(_stepsForMove(bestId), bound);
+			if (bound == bestDepth) {
+				// no state left in the queue can win in fewer steps
+				break;
+			}
+			continue;
+		}
+
+		// every direction is played first, then the children are stored and queued, which grows the tables
+		// and the queue; only playing is counted
+		const int64_t allocationCount = _allocationCount();
+		packer_.unpack(moves_.packedState(entry.id), state);
+		working.load(state);
+		stats_.expandedCount++;
+
+		for (const Dir dir : kAllDirs) {
+			const Player::Result result = PlayerType::apply(map_, working, dir, undoLog);
+			results[int(dir)] = result;
+			if (result != Player::Result::Fail) {
+				working.commit(state);
+			}
+			PlayerType::undo(working, undoLog);
+			if (result == Player::Result::Fail) {
+				continue;
+			}
+			estimates[int(dir)] = result == Player::Result::Win ? 0 : heuristic.estimate(state);
+			packer_.pack(state, childWords.data() + int(dir) * wordCount);
+		}
+
+		stats_.playAllocationCount += _allocationCount() - allocationCount;
+
+		for (const Dir dir : kAllDirs) {
+			const Player::Result result = results[int(dir)];
+			if (result == Player::Result::Fail) {
+				continue;
+			}
+
+			const int depth = entry.depth + 1;
+			const int estimate = estimates[int(dir)];
+			if ((map_.info.turns != -1 && depth + estimate > map_.info.turns) || depth + estimate >= bestDepth) {
+				continue;
+			}
+
+			const PackedWord * const words = childWords.data() + int(dir) * wordCount;
+			const uint64_t hash = packer_.hash(words);
+			StateTable & table = moveIdForState_[_tableIndexForHash(hash)];
+			int id = _findMove(table, words);
+			if (id == -1) {
+				if (depth >= int(storedCounts.size())) {
+					storedCounts.resize(depth + 1);
+				}
+				if (storedCounts[depth] == statesPerDepth) {
+					droppedBound = std::min(droppedBound, depth + estimate);
+					continue;
+				}
+				storedCounts[depth]++;
+				id = moves_.add(entry.id, dir, words);
+				table.insert(hash, id);
+			} else if (depth < moves_.depth(id)) {
+				// reopened if it was expanded already, then its children are relinked in turn
+				moves_.relink(id, entry.id, dir);
+			} else {
+				continue;
+			}
+
+			push(Entry {.id = id, .depth = depth, .estimate = estimate, .win = result == Player::Result::Win});
+		}
+
+		// the entry bounded the queue until its children were in
+		queuedCounts[entry.depth + entry.estimate]--;
+	}
+
+	printf("expanded: %d\n", stats_.expandedCount);
+	if (lowerBound() != bestDepth) {
+		printf("lower bound: %d\n", lowerBound());
+	}
+}
+
+
+template <typename PlayerType, typename HeuristicType>
+void Solver::_searchBeam(int startId, const HeuristicType & heuristic, const int statesPerDepth, const int passCount)
+{
+	// Breadth-first passes keeping the states of each depth the heuristic likes best, each pass twice as wide as
+	// the one before and starting over. A pass ends at the first depth that wins. A shorter win has to go through
+	// a state some pass dropped, so each pass proves the fewer of its own win and the best depth plus estimate
+	// it dropped, and the search stops once that meets the shortest win found, or a pass drops nothing.
+
+	constexpr int kNone = std::numeric_limits<int>::max();
+
+	int bestDepth = kNone;
+	int lowerBound = 0;
+	int width = statesPerDepth;
+	std::vector<int> estimates;
+	std::vector<int> order;
+	State state;
+
+	for (int pass = 0; pass < passCount && lowerBound < bestDepth; ++pass, width *= 2) {
+		if (pass != 0) {
+			_clearMoves();
+			startId = _addStartMove();
+		}
+
+		int passDepth = kNone;
+		int droppedBound = kNone;
+		std::vector<int> layer = {startId};
+		for (int distance = 0; !layer.empty(); ++distance) {
+			const bool isLastTurn = map_.info.turns != -1 && distance == map_.info.turns - 1;
+			stats_.expandedCount += layer.size();
+			std::vector<int> nextLayer = _expandLayer<PlayerType>(layer, isLastTurn);
+
+			if (!winMoveIds_.empty()) {
+				passDepth = distance + 1;
+				if (passDepth < bestDepth) {
+					bestDepth = passDepth;
+					_reportSolution(_stepsForMove(winMoveIds_.front()), std::max(lowerBound, std::min(passDepth, droppedBound)));
+				}
+				// reported already, and gone with the moves of the pass
+				winMoveIds_.clear();
+				break;
+			}
+
+			if (int(nextLayer.size()) > width) {
+				// kept in the tables all the same, a state reached again later would only be further away
+				estimates.resize(nextLayer.size());
+				for (int i = 0; i < int(nextLayer.size()); ++i) {
+					packer_.unpack(moves_.packedState(nextLayer[i]), state);
+					estimates[i] = heuristic.estimate(state);
+				}
+				order.resize(nextLayer.size());
+				std::iota(order.begin(), order.end(), 0);
+				std::nth_element(order.begin(), order.begin() + width, order.end(),
+						[&estimates] (const int a, const int b) {
+							return estimates[a] != estimates[b] ? estimates[a] < estimates[b] : a < b;
+						});
+				for (auto it = order.begin() + width; it != order.end(); ++it) {
+					droppedBound = std::min(droppedBound, distance + 1 + estimates[*it]);
+				}
+				order.resize(width);
+				std::sort(order.begin(), order.end());
+				for (int i = 0; i < width; ++i) {
+					order[i] = nextLayer[order[i]];
+				}
+				nextLayer.assign(order.begin(), order.end());
+			}
+			layer = std::move(nextLayer);
+		}
+
+		lowerBound = std::max(lowerBound, std::min(passDepth, droppedBound));
+		if (droppedBound == kNone) {
+			// nothing was dropped, so the pass was a breadth-first search
+			lowerBound = bestDepth;
+		}
+		printf("pass: %d width: %d steps: %d lower bound: %d\n", pass, width, bestDepth == kNone ? -1 : bestDepth,
+				lowerBound == kNone ? -1 : lowerBound);
+	}
+}
+
+
+template <typename PlayerType, typename HeuristicType>
+void Solver::_searchIterativeDeepening(const int startId, const HeuristicType & heuristic,
+		const int transpositionBits)
+{
+	// IDA*: depth-first searches keeping only the steps they are on, each under a bound on depth plus estimate
+	// raised to the least one the search before went past. States are found again through a transposition table
+	// of the depth they were first reached at in the iteration, and subtrees are handed to hungry threads.
+	// A win found in an iteration shortens the bound of the rest of it, so its shortest one is the shortest.
+
+	constexpr int kNone = std::numeric_limits<int>::max();
+
+	TranspositionTable table(transpositionBits);
+	State state;
+	packer_.unpack(moves_.packedState(startId), state);
+
+	for (int threshold = heuristic.estimate(state); threshold != kNone;) {
+		Deepening deepening(threadCount_, threshold, table);
+		table.startGeneration();
+		table.visit(state.key, 0);
+		deepening.pendingCount = 1;
+		deepening.workers[0].tasks.push_back(DeepeningTask {
+			.words = std::vector<PackedWord>(moves_.packedState(startId),
+					moves_.packedState(startId) + packer_.wordCount()),
+		});
+
+		threadPool_.run(threadCount_, [this, &deepening, &heuristic] (const int workerIndex) {
+			_runDeepeningWorker<PlayerType>(deepening, workerIndex, heuristic);
+		});
+
+		stats_.expandedCount += deepening.expandedCount;
+		printf("iteration: bound: %d expanded: %lld\n", threshold, (long long)deepening.expandedCount);
+
+		if (deepening.bestDepth != kNone) {
+			const int bestDepth = deepening.bestDepth;
+			_reportSolution(std::move(deepening.bestSteps), bestDepth);
+			break;
+		}
+		// past the turns of the level, no bound is ever set
+		threshold = deepening.nextThreshold;
+	}
+
+	printf("expanded: %d\n", stats_.expandedCount);
+}
+
+
+template <typename PlayerType, typename HeuristicType>
+void Solver::_runDeepeningWorker(Deepening & deepening, const int workerIndex, const HeuristicType & heuristic)
+{
+	// each thread searches its own tasks last in first out, and steals the oldest, biggest ones of the others
+	const auto take = [&deepening, workerIndex] () -> std::optional<DeepeningTask> {
+		const int workerCount = deepening.workers.size();
+		for (int i = 0; i < workerCount; ++i) {
+			Deepening::Worker & worker = deepening.workers[(workerIndex + i) % workerCount];
+			const std::lock_guard lock(worker.mutex);
+			if (worker.tasks.empty()) {
+				continue;
+			}
+			DeepeningTask task;
+			if (i == 0) {
+				task = std::move(worker.tasks.back());
+				worker.tasks.pop_back();
+			} else {
+				task = std::move(worker.tasks.front());
+				worker.tasks.pop_front();
+			}
+			return task;
+		}
+		return std::nullopt;
+	};
+
+	// its own copy, as estimates count their lookups
+	const HeuristicType threadHeuristic = heuristic;
+	DeepeningThread thread;
+	thread.undoLogs.resize(deepening.threshold + 1);
+	bool hungry = false;
+
+	while (true) {
+		// read before looking, so that a task queued in between wakes the wait up
+		const int signal = deepening.signalCount;
+		std::optional<DeepeningTask> task = take();
+		if (!task) {
+			if (deepening.pendingCount == 0) {
+				break;
+			}
+			if (!hungry) {
+				deepening.hungryCount++;
+				hungry = true;
+			}
+			deepening.signalCount.wait(signal);
+			continue;
+		}
+		if (hungry) {
+			deepening.hungryCount--;
+			hungry = false;
+		}
+
+		packer_.unpack(task->words.data(), thread.state);
+		thread.working.load(thread.state);
+		thread.steps = std::move(task->steps);
+		_deepen<PlayerType>(deepening, thread, workerIndex, threadHeuristic);
+		if (--deepening.pendingCount == 0) {
+			deepening.signalCount++;
+			deepening.signalCount.notify_all();
+		}
+	}
+
+	if (hungry) {
+		deepening.hungryCount--;
+	}
+	deepening.expandedCount += thread.expandedCount;
+}
+
+
+template <typename PlayerType, typename HeuristicType>
+void Solver::_deepen(Deepening & deepening, DeepeningThread & thread, const int workerIndex,
+		const HeuristicType & heuristic)
+{
+	const auto lower = [] (std::atomic<int> & value, const int bound) {
+		int current = value;
+		while (bound < current && !value.compare_exchange_weak(current, bound)) {
+		}
+	};
+
+	const int depth = int(thread.steps.size()) + 1;
+	UndoLog & undoLog = thread.undoLogs[depth - 1];
+	thread.expandedCount++;
+
+	for (const Dir dir : kAllDirs) {
+		const Player::Result result = PlayerType::apply(map_, thread.working, dir, undoLog);
+
+		if (result == Player::Result::Win && depth < deepening.bestDepth &&
+				(map_.info.turns == -1 || depth <= map_.info.turns)) {
+			const std::lock_guard lock(deepening.bestMutex);
+			if (depth < deepening.bestDepth) {
+				deepening.bestDepth = depth;
+				deepening.bestSteps = thread.steps;
+				deepening.bestSteps.push_back(dir);
+			}
+		}
+		if (result != Player::Result::None) {
+			PlayerType::undo(thread.working, undoLog);
+			continue;
+		}
+
+		thread.working.commit(thread.state);
+		const int bound = depth + heuristic.estimate(thread.state);
+		if (bound >= deepening.bestDepth || (map_.info.turns != -1 && bound > map_.info.turns)) {
+			PlayerType::undo(thread.working, undoLog);
+			continue;
+		}
+		if (bound > deepening.threshold) {
+			lower(deepening.nextThreshold, bound);
+			PlayerType::undo(thread.working, undoLog);
+			continue;
+		}
+		if (deepening.table.visit(thread.working.key(), depth)) {
+			PlayerType::undo(thread.working, undoLog);
+			continue;
+		}
+
+		thread.steps.push_back(dir);
+		if (deepening.hungryCount > 0 && deepening.threshold - depth >= kMinDeepeningTaskDistance) {
+			DeepeningTask task {
+				.words = std::vector<PackedWord>(packer_.wordCount()),
+				.steps = thread.steps,
+			};
+			packer_.pack(thread.state, task.words.data());
+			deepening.pendingCount++;
+			Deepening::Worker & worker = deepening.workers[workerIndex];
+			{
+				const std::lock_guard lock(worker.mutex);
+				worker.tasks.push_back(std::move(task));
+			}
+			deepening.signalCount++;
+			deepening.signalCount.notify_one();
+		} else {
+			_deepen<PlayerType>(deepening, thread, workerIndex, heuristic);
+		}
+		thread.steps.pop_back();
+
+		PlayerType::undo(thread.working, undoLog);
+	}
+}
+
+
+template <typename PlayerType>
+void Solver::_searchDistributed()
+{
+	// HDA*-style breadth-first search: each state is owned by the worker process its hash picks, which alone
+	// stores it and plays it. Workers play their part of a layer, post the children to their owners in batches
+	// and take in the new ones they own; the coordinator starts each layer once every worker answered for the last.
+	// Moves link to their previous one by worker and id, so the coordinator walks a win back worker by worker.
+
+	const int workerCount = threadCount_;
+	WorkerGroup workers(workerCount, [this] (WorkerGroup::Link & link) {
+		_runDistributedWorker<PlayerType>(link);
+	});
+
+	const auto ask = [&workers] (const int worker, const DistributedCommand & command) -> DistributedReply {
+		workers.send(worker, command);
+		return workers.receive<DistributedReply>(worker);
+	};
+
+	int storedCount = 1;
+	int winWorker = -1;
+	int winId = -1;
+	for (int distance = 0; winWorker == -1; ++distance) {
+		const bool isLastTurn = map_.info.turns != -1 && distance == map_.info.turns - 1;
+		const DistributedCommand command = {
+			.type = isLastTurn ? DistributedCommand::Type::ExpandLast : DistributedCommand::Type::Expand,
 		};
+		for (int worker = 0; worker < workerCount; ++worker) {
+			workers.send(worker, command);
+		}
+
+		int nextCount = 0;
+		for (int worker = 0; worker < workerCount; ++worker) {
+			const DistributedReply reply = workers.receive<DistributedReply>(worker);
+			nextCount += reply.nextCount;
+			stats_.expandedCount += reply.expandedCount;
+			storedCount += reply.storedCount;
+			if (reply.winId != -1 && winWorker == -1) {
+				winWorker = worker;
+				winId = reply.winId;
+			}
+		}
+		if (nextCount == 0) {
+			break;
+		}
 	}
-};
+
+	if (winWorker != -1) {
+		Steps steps;
+		for (int worker = winWorker, id = winId;;) {
+			const DistributedReply reply = ask(worker, DistributedCommand {
+				.type = DistributedCommand::Type::Parent,
+				.id = id,
+			});
+			if (reply.parentWorker == -1) {
+				break;
+			}
+			steps.push_back(reply.dir);
+			worker = reply.parentWorker;
+			id = reply.parentId;
+		}
+		std::reverse(steps.begin(), steps.end());
+		const int stepCount = steps.size();
+		_reportSolution(std::move(steps), stepCount);
+	}
+
+	for (int worker = 0; worker < workerCount; ++worker) {
+		workers.send(worker, DistributedCommand {.type = DistributedCommand::Type::Quit});
+	}
+
+	stats_.moveCount = storedCount;
+	printf("workers: %d stored: %d expanded: %d\n", workerCount, storedCount, stats_.expandedCount);
+}
+
+
+template <typename PlayerType>
+void Solver::_runDistributedWorker(WorkerGroup::Link & link)
+{
+	// in the forked process, with moves of its own: ids are local, previous moves can be on any worker
+
+	const int workerCount = link.workerCount();
+	const int wordCount = packer_.wordCount();
+	const auto ownerForHash = [workerCount] (const uint64_t hash) {
+		// the tables take the low half for themselves
+		return int((hash >> 32) % workerCount);
+	};
+
+	std::vector<PackedWord> states;
+	std::vector<int> previousWorkers;
+	std::vector<int> previousIds;
+	std::vector<Dir> dirs;
+	StateTable table;
+	std::vector<int> layer;
+
+	const auto add = [&] (const PackedWord * const words, const uint64_t hash, const int previousWorker,
+			const int previousId, const Dir dir) -> int {
+		const int id = previousIds.size();
+		states.insert(states.end(), words, words + wordCount);
+		previousWorkers.push_back(previousWorker);
+		previousIds.push_back(previousId);
+		dirs.push_back(dir);
+		table.insert(hash, id);
+		return id;
+	};
+
+	{
+		std::vector<PackedWord> startWords(wordCount);
+		packer_.pack(map_.state, startWords.data());
+		const uint64_t hash = packer_.hash(startWords.data());
+		if (ownerForHash(hash) == link.index()) {
+			layer.push_back(add(startWords.data(), hash, -1, -1, kNullDir));
+		}
+	}
+
+	const int recordSize = sizeof(DistributedChild) + wordCount * sizeof(PackedWord);
+	std::vector<std::vector<uint8_t>> batches(workerCount);
+	WorkingState working;
+	UndoLog undoLog;
+	std::vector<PackedWord> words(wordCount);
+	State state;
+
+	while (true) {
+		const DistributedCommand command = link.receive<DistributedCommand>();
+
+		if (command.type == DistributedCommand::Type::Quit) {
+			return;
+		}
+
+		if (command.type == DistributedCommand::Type::Parent) {
+			link.send(DistributedReply {
+				.parentWorker = previousWorkers[command.id],
+				.parentId = previousIds[command.id],
+				.dir = dirs[command.id],
+			});
+			continue;
+		}
+
+		for (const int id : layer) {
+			packer_.unpack(states.data() + id * wordCount, state);
+			working.load(state);
+
+			for (const Dir dir : kAllDirs) {
+				const Player::Result result = PlayerType::apply(map_, working, dir, undoLog);
+				if (result != Player::Result::Fail) {
+					working.commit(state);
+				}
+				PlayerType::undo(working, undoLog);
+				if (result == Player::Result::Fail) {
+					continue;
+				}
+
+				const DistributedChild child = {
+					.parentId = id,
+					.dir = dir,
+					.win = result == Player::Result::Win,
+				};
+				packer_.pack(state, words.data());
+				const int owner = ownerForHash(packer_.hash(words.data()));
+
+				std::vector<uint8_t> & batch = batches[owner];
+				const size_t offset = batch.size();
+				batch.resize(offset + recordSize);
+				std::memcpy(batch.data() + offset, &child, sizeof(child));
+				std::memcpy(batch.data() + offset + sizeof(child), words.data(), wordCount * sizeof(PackedWord));
+				if (int(batch.size()) >= kDistributedBatchSize) {
+					link.post(owner, batch.data(), batch.size());
+					batch.clear();
+				}
+			}
+		}
+
+		for (int owner = 0; owner < workerCount; ++owner) {
+			if (!batches[owner].empty()) {
+				link.post(owner, batches[owner].data(), batches[owner].size());
+				batches[owner].clear();
+			}
+		}
+
+		// taken in worker by worker, in the order each posted them, so ids never depend on timing
+		DistributedReply reply = {.expandedCount = int(layer.size())};
+		std::vector<int> nextLayer;
+		const std::vector<std::vector<uint8_t>> received = link.finish();
+		for (int sender = 0; sender < workerCount; ++sender) {
+			const std::vector<uint8_t> & records = received[sender];
+			for (size_t offset = 0; offset < records.size(); offset += recordSize) {
+				DistributedChild child;
+				std::memcpy(&child, records.data() + offset, sizeof(child));
+				const PackedWord * const childWords = reinterpret_cast<const PackedWord *>(records.data() + offset +
+						sizeof(child));
+				const uint64_t hash = packer_.hash(childWords);
+				const int known = table.find(hash, [this, &states, childWords, wordCount] (const int id) {
+					return packer_.equals(states.data() + id * wordCount, childWords);
+				});
+				if (known != -1) {
+					continue;
+				}
+
+				const int id = add(childWords, hash, sender, child.parentId, child.dir);
+				reply.storedCount++;
+				if (child.win) {
+					if (reply.winId == -1) {
+						reply.winId = id;
+					}
+				} else if (command.type != DistributedCommand::Type::ExpandLast) {
+					nextLayer.push_back(id);
+				}
+			}
+		}
+
+		layer = std::move(nextLayer);
+		reply.nextCount = layer.size();
+		link.send(reply);
+	}
+}
+
+
+template <typename PlayerType>
+void Solver::_searchFrontier(const int transpositionBits)
+{
+	// Frontier search: breadth-first keeping only the layer before, the layer played and the one it fills, which
+	// is as far back as a step undone leads. Steps are not all undone by the opposite one though, and states seen
+	// further back are caught by a transposition table of fixed size instead. What it forgets is only played again,
+	// as a state still turns up first at its distance, so the shortest win is as exact as breadth-first search's;
+	// but only the turns of the level or kMaxFrontierDepth end a search without any. The steps are rebuilt by
+	// searching again to the win, keeping the layer halfway there, which splits the win into two halves to
+	// rebuild the same way.
+
+	TranspositionTable seen(transpositionBits);
+	std::vector<PackedWord> startWords(packer_.wordCount());
+	packer_.pack(map_.state, startWords.data());
+
+	const int maxDepth = map_.info.turns != -1 ? map_.info.turns : kMaxFrontierDepth;
+	FrontierResult win = _searchFrontierLayers<PlayerType>(seen, startWords.data(), nullptr, true, maxDepth, -1);
+	const int searchExpandedCount = stats_.expandedCount;
+
+	if (win.depth != -1) {
+		Steps steps;
+		_rebuildFrontierPath<PlayerType>(seen, startWords, win.targetWords, true, win.depth, steps);
+		assert(int(steps.size()) == win.depth);
+		_reportSolution(std::move(steps), win.depth);
+	}
+
+	stats_.moveCount = frontierPeakCount_;
+	printf("frontier: peak states: %d expanded: %d rebuilding: %d\n", frontierPeakCount_, searchExpandedCount,
+			stats_.expandedCount - searchExpandedCount);
+}
+
+
+template <typename PlayerType>
+Solver::FrontierResult Solver::_searchFrontierLayers(TranspositionTable & seen, const PackedWord * const start,
+		const PackedWord * const target, const bool targetWins, const int maxDepth, const int middleDepth)
+{
+	// Searches from start up to maxDepth for target, reached by a winning step or not, or for any win without one.
+	// States past middleDepth take their ancestor in the middle layer from their previous state.
+
+	const int wordCount = packer_.wordCount();
+	FrontierLayer previous;
+	FrontierLayer current;
+	FrontierLayer next;
+	std::vector<PackedWord> middleWords;
+
+	const auto find = [this, wordCount] (const FrontierLayer & layer, const uint64_t hash, const PackedWord * words) {
+		return layer.table.find(hash, [this, &layer, wordCount, words] (const int index) {
+			return packer_.equals(layer.words.data() + index * wordCount, words);
+		});
+	};
+	const auto add = [wordCount] (FrontierLayer & layer, const uint64_t hash, const PackedWord * words,
+			const int middleIndex) {
+		layer.table.insert(hash, layer.size());
+		layer.words.insert(layer.words.end(), words, words + wordCount);
+		layer.middleIndices.push_back(middleIndex);
+	};
+
+	seen.startGeneration();
+	seen.visit(packer_.hash(start), 0);
+	add(current, packer_.hash(start), start, -1);
+
+	FrontierResult found;
+	WorkingState working;
+	UndoLog undoLog;
+	std::vector<PackedWord> words(wordCount);
+	State state;
+
+	for (int depth = 1; depth <= maxDepth && current.size() != 0; ++depth) {
+		stats_.expandedCount += current.size();
+
+		for (int parentIndex = 0; parentIndex < current.size(); ++parentIndex) {
+			packer_.unpack(current.words.data() + parentIndex * wordCount, state);
+			working.load(state);
+
+			for (const Dir dir : kAllDirs) {
+				const Player::Result result = PlayerType::apply(map_, working, dir, undoLog);
+				if (result != Player::Result::Fail) {
+					working.commit(state);
+				}
+				PlayerType::undo(working, undoLog);
+				if (result == Player::Result::Fail) {
+					continue;
+				}
+
+				packer_.pack(state, words.data());
+				const bool win = result == Player::Result::Win;
+				const int middleIndex = middleDepth != -1 && depth > middleDepth ?
+						current.middleIndices[parentIndex] : -1;
+
+				if (target ? win == targetWins && packer_.equals(words.data(), target) : win) {
+					found.depth = depth;
+					found.dir = dir;
+					found.targetWords = words;
+					if (middleIndex != -1) {
+						found.middleWords.assign(middleWords.begin() + middleIndex * wordCount,
+								middleWords.begin() + (middleIndex + 1) * wordCount);
+					}
+					return found;
+				}
+				if (win || depth == maxDepth) {
+					continue;
+				}
+
+				const uint64_t hash = packer_.hash(words.data());
+				if (find(previous, hash, words.data()) != -1 || find(current, hash, words.data()) != -1 ||
+						find(next, hash, words.data()) != -1 || seen.visit(hash, depth)) {
+					continue;
+				}
+				add(next, hash, words.data(), depth == middleDepth ? next.size() : middleIndex);
+			}
+		}
+
+		if (depth == middleDepth) {
+			middleWords = next.words;
+		}
+		frontierPeakCount_ = std::max(frontierPeakCount_, previous.size() + current.size() + next.size() +
+				int(middleWords.size()) / wordCount);
+
+		previous = std::move(current);
+		current = std::move(next);
+		next = FrontierLayer();
+	}
+
+	return found;
+}
+
+
+template <typename PlayerType>
+void Solver::_rebuildFrontierPath(TranspositionTable & seen, const std::vector<PackedWord> & from,
+		const std::vector<PackedWord> & to, const bool toWins, const int depth, Steps & steps)
+{
+	// to is depth steps away from from, the fewest, or a shorter win would go through the middle state
+	if (depth == 1) {
+		const FrontierResult result = _searchFrontierLayers<PlayerType>(seen, from.data(), to.data(), toWins, 1, -1);
+		assert(result.depth == 1);
+		steps.push_back(result.dir);
+		return;
+	}
+
+	const int middleDepth = depth / 2;
+	const FrontierResult result = _searchFrontierLayers<PlayerType>(seen, from.data(), to.data(), toWins, depth,
+			middleDepth);
+	assert(result.depth == depth);
+	_rebuildFrontierPath<PlayerType>(seen, from, result.middleWords, false, middleDepth, steps);
+	_rebuildFrontierPath<PlayerType>(seen, result.middleWords, to, toWins, depth - middleDepth, steps);
+}
+
+
+template <typename PlayerType>
+std::vector<int> Solver::_expandLayer(const std::vector<int> & layer, const bool isLastTurn)
+{
+	// chunks are played in parallel, deduplicated per table and numbered in queue order,
+	// so move ids never depend on the thread count
+
+	const int chunkCount = (int(layer.size()) + kChunkSize - 1) / kChunkSize;
+	std::vector<Chunk> chunks(chunkCount);
+
+	threadPool_.run(chunkCount, [this, &layer, &chunks] (const int chunkIndex) {
+		Chunk & chunk = chunks[chunkIndex];
+		chunk.childIndicesForTable.resize(moveIdForState_.size());
+
+		const int begin = chunkIndex * kChunkSize;
+		const int end = std::min(begin + kChunkSize, int(layer.size()));
+
+		chunk.children.reserve((end - begin) * kAllDirs.size());
+		chunk.packedStates.reserve((end - begin) * kAllDirs.size() * packer_.wordCount());
+
+		// sized for any state up front, so that playing the chunk does not allocate
+		State unpacked;
+		State state;
+		for (State * const buffer : {&unpacked, &state}) {
+			buffer->dudes.reserve(kMaxDudeCount);
+			buffer->mines.reserve(kMaxMineCount);
+		}
+		WorkingState working;
+		UndoLog undoLog;
+
+		const int64_t allocationCount = _allocationCount();
+
+		for (int i = begin; i < end; ++i) {
+			const int currentMoveId = layer[i];
+			packer_.unpack(moves_.packedState(currentMoveId), unpacked);
+			working.load(unpacked);
+
+			for (const Dir dir : kAllDirs) {
+				// every direction is tried in place and undone afterwards
+				const Player::Result result = PlayerType::apply(map_, working, dir, undoLog);
+				if (result != Player::Result::Fail) {
+					working.commit(state);
+				}
+				PlayerType::undo(working, undoLog);
+				assert(working.key() == unpacked.key);
+
+				if (result == Player::Result::Fail) {
+					continue;
+				}
+
+				const int packedOffset = chunk.packedStates.size();
+				chunk.packedStates.resize(packedOffset + packer_.wordCount());
+				PackedWord * const words = chunk.packedStates.data() + packedOffset;
+				packer_.pack(state, words);
+
+				const int tableIndex = _tableIndexForHash(packer_.hash(words));
+
+				chunk.children.push_back(Child {
+					.previousId = currentMoveId,
+					.dir = dir,
+					.result = result,
+					.packedOffset = packedOffset,
+					.tableIndex = tableIndex,
+					.id = _findMove(moveIdForState_[tableIndex], words),
+				});
+			}
+		}
+
+		chunk.playAllocationCount = _allocationCount() - allocationCount;
+
+		// the per table lists grow, so they are filled once the states are played
+		for (int childIndex = 0; childIndex < int(chunk.children.size()); ++childIndex) {
+			chunk.childIndicesForTable[chunk.children[childIndex].tableIndex].push_back(childIndex);
+		}
+	});
+
+	int childCount = 0;
+	std::vector<const PackedWord *> packedChildren;
+	for (Chunk & chunk : chunks) {
+		stats_.playAllocationCount += chunk.playAllocationCount;
+		chunk.firstChildIndex = childCount;
+		childCount += chunk.children.size();
+		for (const Child & child : chunk.children) {
+			packedChildren.push_back(chunk.packedStates.data() + child.packedOffset);
+		}
+	}
+
+	threadPool_.run(moveIdForState_.size(), [this, &chunks, &packedChildren] (const int tableIndex) {
+		// children new to this layer, keyed by their index among all children of the layer
+		StateTable pending;
+		for (Chunk & chunk : chunks) {
+			for (const int childIndex : chunk.childIndicesForTable[tableIndex]) {
+				Child & child = chunk.children[childIndex];
+				if (child.id != -1) continue;
+				const PackedWord * const words = chunk.packedStates.data() + child.packedOffset;
+				child.sameChildIndex = pending.findOrInsert(packer_.hash(words), chunk.firstChildIndex + childIndex,
+						[this, &packedChildren, words] (const int index) {
+							return packer_.equals(packedChildren[index], words);
+						});
+			}
+		}
+	});
+
+	std::vector<int> idForChild(childCount);
+	std::vector<int> nextLayer;
+
+	for (Chunk & chunk : chunks) {
+		for (int childIndex = 0; childIndex < int(chunk.children.size()); ++childIndex) {
+			Child & child = chunk.children[childIndex];
+
+			const MoveRes moveRes = [this, &chunk, &child, &idForChild] () -> MoveRes {
+				if (child.id != -1) {
+					// breadth-first order never finds a known state at a shorter distance
+					return MoveRes {
+						.id = child.id,
+						.same = true,
+					};
+				}
+				if (child.sameChildIndex != -1) {
+					return MoveRes {
+						.id = idForChild[child.sameChildIndex],
+						.same = true,
+					};
+				}
+				const int id = moves_.add(child.previousId, child.dir,
+						chunk.packedStates.data() + child.packedOffset);
+				child.id = id;
+				child.added = true;
+				return MoveRes {
+					.id = id,
+					.same = false,
+				};
+			}();
+
+			idForChild[chunk.firstChildIndex + childIndex] = moveRes.id;
+
+			if (!moveRes.same) {
+				if (child.result == Player::Result::Win) {
+					winMoveIds_.push_back(moveRes.id);
+				} else {
+					if (!isLastTurn) {
+						nextLayer.push_back(moveRes.id);
+					}
+				}
+			}
+
+#ifdef ENABLE_DEBUG
+			const int currentMoveId = child.previousId;
+			const Dir dir = child.dir;
+			if (currentMoveId == kDebugMoveId && dir == kDebugMoveDir) {
+				int breakhere = 1;
+			}
+
+			const std::vector<int> steps = _getSteps(moveRes.id);
+			const std::string stepsString = _stepsToString(steps);
+
+			if (!kDebugOnlyExpectedSteps || kDebugExpectedSteps.starts_with(stepsString)) {
+				printf("move: from: %d to: %s same: %d id: %d\n", currentMoveId, nameForDir(dir).data(), moveRes.same, moveRes.id);
+				if (!moveRes.same) {
+					const State state = packer_.unpack(moves_.packedState(moveRes.id));
+					printf("    killer: %d %d\n", state.killer.pos.x, state.killer.pos.y);
+					for (const Dude & d : state.dudes) {
+						printf("    dude: %d %d - %s", d.pos.x, d.pos.y, nameForDudeType(d.type).data());
+						switch (d.type) {
+						case Dude::Type::Victim:
+						case Dude::Type::Cat:
+							break;
+						case Dude::Type::Cop:
+						case Dude::Type::Swat:
+							printf(" (%s)", nameForDir(d.dir).data());
+							break;
+						case Dude::Type::Drop:
+							printf(" (%s)", nameForOrientation(d.orientation).data());
+							break;
+						}
+						printf("\n");
+					}
+				}
+			}
+			fflush(stdout);
+
+			if (stepsString == kDebugExpectedSteps) {
+				int b = 1;
+			}
+#endif
+		}
+	}
+
+	threadPool_.run(moveIdForState_.size(), [this, &chunks] (const int tableIndex) {
+		StateTable & table = moveIdForState_[tableIndex];
+		for (const Chunk & chunk : chunks) {
+			for (const int childIndex : chunk.childIndicesForTable[tableIndex]) {
+				const Child & child = chunk.children[childIndex];
+				if (!child.added) continue;
+				table.insert(packer_.hash(moves_.packedState(child.id)), child.id);
+			}
+		}
+	});
+
+	return nextLayer;
+}
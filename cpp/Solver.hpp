@@ -1,10 +1,20 @@
-
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <functional>
-#include <queue>
+#include <limits>
+#include <mutex>
 
 #include "Map.hpp"
+#include "MoveStore.hpp"
+#include "Packer.hpp"
+#include "PatternDatabase.hpp"
+#include "Player.hpp"
+#include "StateTable.hpp"
+#include "ThreadPool.hpp"
+#include "TranspositionTable.hpp"
+#include "WorkerGroup.hpp"
 
 
 
@@ -13,47 +23,233 @@ class Solver {
 public:
 	struct Solution {
 		Steps steps;
+		int lowerBound = 0; // proven fewest steps of any win, the size of steps once it is the shortest
+	};
+
+	enum class Search {
+		Breadth, // every reachable state, a layer at a time, on every thread
+		AStar, // the fewest states Heuristic lets through, up to the first shortest win, on one thread
+		Beam, // the best states of each depth, passes widening until the shortest win is proven, on every thread
+		WeightedAStar, // A* leaning on the estimate, with the states of each depth capped, shortening its wins
+		IdaStar, // depth-first under a rising bound on depth plus estimate, storing no states, on every thread
+		Distributed, // breadth-first with states owned by worker processes by hash, a process per thread
+		Frontier, // breadth-first keeping three layers, then again over halves of the win to rebuild it, on one thread
+	};
+
+	struct Config {
+		int threadCount = 1;
+		bool genericPlayer = false; // plays with BasicPlayer even in a binary built for the map
+		Search search = Search::Breadth;
+		const PatternDatabase * patternDatabase = nullptr; // tightens the estimate, has to cover the map
+		int statesPerDepth = 1 << 12; // most states beam and weighted A* keep at a depth, beam doubles it each pass
+		int beamPasses = 8;
+		double weight = 2; // of the estimate in weighted A*
+		int transpositionBits = 20; // log2 of the slots of the IDA* transposition table
+		// heap allocations made so far by the calling thread, when a test counts those of playing states
+		int64_t (*allocationCount)() = nullptr;
+	};
+
+	// what a search went through, to compare searches
+	struct Stats {
+		int expandedCount = 0; // states whose steps were played
+		int moveCount = 0; // states stored
+		int64_t databaseLookupCount = 0; // estimates that looked victims up in the pattern database
+		int64_t databaseRaiseCount = 0; // and those it raised
+		int64_t playAllocationCount = 0; // made while breadth-first and best-first play states, see Config
 	};
 
 	using SolutionCallback = std::function<void(Solution && solution)>;
 
-	static void solve(const Map & map, const SolutionCallback & cb);
+	static Stats solve(const Map & map, const SolutionCallback & cb);
+	static Stats solve(const Map & map, const Config & config, const SolutionCallback & cb);
 
 private:
-	struct Move {
-		Dir dir;
+	struct MoveRes {
+		int id;
+		bool same;
+	};
+
+	struct Child {
 		int previousId;
+		Dir dir;
+		Player::Result result;
+		int packedOffset;
+		int tableIndex;
+		int id = -1;
+		int sameChildIndex = -1;
+		bool added = false;
+	};
+
+	struct Chunk {
+		std::vector<Child> children;
+		std::vector<PackedWord> packedStates;
+		std::vector<std::vector<int>> childIndicesForTable;
+		int firstChildIndex = 0;
+		int64_t playAllocationCount = 0;
+	};
+
+	// a subtree of an IDA* iteration, from the state its steps lead to
+	struct DeepeningTask {
+		std::vector<PackedWord> words {};
+		Steps steps {};
+	};
+
+	// what the threads of an IDA* iteration share
+	struct Deepening {
+		struct Worker {
+			std::mutex mutex;
+			std::deque<DeepeningTask> tasks; // taken from the back by the worker, stolen from the front
+		};
+
+		Deepening(int threadCount, int threshold, TranspositionTable & table) :
+			workers(threadCount),
+			threshold(threshold),
+			table(table)
+		{
+		}
+
+		std::vector<Worker> workers;
+		const int threshold;
+		TranspositionTable & table;
+		std::atomic<int> pendingCount = 0; // tasks queued or being searched
+		std::atomic<int> hungryCount = 0; // threads looking for a task
+		std::atomic<int> signalCount = 0; // bumped when a task is queued or the last one is done, hungry threads wait on it
+		std::atomic<int> nextThreshold = std::numeric_limits<int>::max();
+		std::atomic<int> bestDepth = std::numeric_limits<int>::max();
+		std::atomic<int64_t> expandedCount = 0;
+		std::mutex bestMutex;
+		Steps bestSteps;
+	};
+
+	// the state a thread of an IDA* iteration is at, with a log per step to undo it
+	struct DeepeningThread {
+		WorkingState working;
+		std::vector<UndoLog> undoLogs;
 		State state;
+		Steps steps;
+		int64_t expandedCount = 0;
 	};
 
-	struct MoveRes {
-		int id;
-		bool same;
+	// what the coordinator of a distributed search asks a worker, and what the worker answers
+	struct DistributedCommand {
+		enum class Type : uint8_t {
+			Expand, // plays the layer, sends the children to their owners and takes in those it owns
+			ExpandLast, // the same, on the last turn of the level
+			Parent, // the move before id
+			Quit,
+		};
+
+		Type type;
+		int id = -1;
+	};
+
+	struct DistributedReply {
+		int nextCount = 0; // states of the next layer
+		int expandedCount = 0;
+		int storedCount = 0;
+		int winId = -1; // the first new win of the layer
+		int parentWorker = -1; // of the move asked for, none for the start
+		int parentId = -1;
+		Dir dir = kNullDir;
+	};
+
+	// a child as a worker posts it to the owner of its state, followed by the state
+	struct DistributedChild {
+		int parentId;
+		Dir dir;
+		bool win;
+	};
+
+	// a layer of a frontier search
+	struct FrontierLayer {
+		std::vector<PackedWord> words;
+		std::vector<int> middleIndices; // of each state's ancestor in the middle layer, once past it
+		StateTable table;
+
+		int size() const noexcept { return int(middleIndices.size()); }
+	};
+
+	// what a frontier search reached its target at
+	struct FrontierResult {
+		int depth = -1; // none if the target was never reached
+		Dir dir = kNullDir; // of the last step
+		std::vector<PackedWord> targetWords; // the state of the first win, when any win would do
+		std::vector<PackedWord> middleWords; // the target's ancestor in the middle layer
 	};
 
-	Solver(const Map & map, const SolutionCallback & cb);
+	static constexpr int kChunkSize = 64;
+	static constexpr int kMaxFrontierDepth = 1 << 12; // frontiers can loop forever on cycles the tables forget
+	static constexpr int kDistributedBatchSize = 1 << 16; // bytes of children posted to a worker at once
+	static constexpr int kMinDeepeningTaskDistance = 4; // least depth left under the threshold to hand a subtree out
+	static constexpr int kTablesPerThread = 4;
+
+	Solver(const Map & map, const Config & config, const SolutionCallback & cb);
+
+	int _addStartMove();
+	void _clearMoves();
+	Steps _stepsForMove(int moveId) const;
+	void _reportSolution(Steps && steps, int lowerBound);
 
 	std::vector<int> _getSteps(const int moveId) const noexcept;
 	std::string _stepsToString(const std::vector<int> & steps) const noexcept;
 
-	int _moveDistance(const int moveId) const noexcept;
-	MoveRes _addMove(Move && move);
-
-	std::unordered_map<State, int> moveIdForState_;
-	std::vector<Move> moves_;
+	int64_t _allocationCount() const noexcept;
+	int _tableIndexForHash(uint64_t hash) const noexcept;
+	int _findMove(const StateTable & table, const PackedWord * words) const noexcept;
+	template <typename PlayerType>
+	void _searchBreadthFirst(int startId);
+	template <typename PlayerType, typename HeuristicType>
+	void _searchBestFirst(int startId, const HeuristicType & heuristic, double weight, int statesPerDepth);
+	template <typename PlayerType, typename HeuristicType>
+	void _searchBeam(int startId, const HeuristicType & heuristic, int statesPerDepth, int passCount);
+	template <typename PlayerType, typename HeuristicType>
+	void _searchIterativeDeepening(int startId, const HeuristicType & heuristic, int transpositionBits);
+	template <typename PlayerType, typename HeuristicType>
+	void _runDeepeningWorker(Deepening & deepening, int workerIndex, const HeuristicType & heuristic);
+	template <typename PlayerType, typename HeuristicType>
+	void _deepen(Deepening & deepening, DeepeningThread & thread, int workerIndex, const HeuristicType & heuristic);
+	template <typename PlayerType>
+	void _searchDistributed();
+	template <typename PlayerType>
+	void _runDistributedWorker(WorkerGroup::Link & link);
+	template <typename PlayerType>
+	void _searchFrontier(int transpositionBits);
+	template <typename PlayerType>
+	FrontierResult _searchFrontierLayers(TranspositionTable & seen, const PackedWord * start, const PackedWord * target,
+			bool targetWins, int maxDepth, int middleDepth);
+	template <typename PlayerType>
+	void _rebuildFrontierPath(TranspositionTable & seen, const std::vector<PackedWord> & from,
+			const std::vector<PackedWord> & to, bool toWins, int depth, Steps & steps);
+	template <typename PlayerType>
+	std::vector<int> _expandLayer(const std::vector<int> & layer, bool isLastTurn);
+
+	const Map & map_;
+	const SolutionCallback & cb_;
+	const int threadCount_;
+	int64_t (* const allocationCount_)();
+	const Packer packer_;
+
+	std::vector<StateTable> moveIdForState_;
+	MoveStore moves_;
 	std::vector<int> winMoveIds_;
-	std::queue<int> moveIdsLeft_;
+	int solutionCount_ = 0; // reported by searches that report as they go
+	int frontierPeakCount_ = 0; // most states a frontier search held at once
+	Stats stats_;
+	ThreadPool threadPool_; // runs the parallel steps of breadth-first and iterative deepening searches
 };
 
 
 
 
-inline int Solver::_moveDistance(const int moveId) const noexcept
+inline int64_t Solver::_allocationCount() const noexcept
 {
-	int distance = -1;
-	for (int id = moveId; id != -1;) {
-		id = moves_[id].previousId;
-		distance++;
-	}
-	return distance;
+	return allocationCount_ ? allocationCount_() : 0;
 }
+
+
+inline int Solver::_tableIndexForHash(const uint64_t hash) const noexcept
+{
+	// tables take the low half of the hash for themselves
+	return (hash >> 32) % moveIdForState_.size();
+}
+
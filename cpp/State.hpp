@@ -1,6 +1,9 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+
 #include "Common.hpp"
 
 
@@ -52,11 +55,30 @@ struct Dude {
 		if (type == Type::Cop || type == Type::Swat) {
 			if (dir != other.dir) return false;
 		}
+		if (type == Type::Drop) {
+			if (orientation != other.orientation) return false;
+		}
 		return true;
 	}
 };
 
 
+template<>
+struct std::hash<Dude> {
+	std::size_t operator()(const Dude & dude) const noexcept
+	{
+		std::size_t hash = combineHash(std::hash<Pos>{}(dude.pos), std::size_t(dude.type));
+		if (dude.type == Dude::Type::Cop || dude.type == Dude::Type::Swat) {
+			hash = combineHash(hash, std::size_t(dude.dir));
+		}
+		if (dude.type == Dude::Type::Drop) {
+			hash = combineHash(hash, std::size_t(dude.orientation));
+		}
+		return hash;
+	}
+};
+
+
 inline std::string_view nameForDudeType(const Dude::Type & type) noexcept
 {
 	switch (type) {
@@ -91,11 +113,69 @@ struct Mine {
 
 
 
+struct Zobrist {
+	static constexpr int kDudeVariantCount = 13;
+
+	using Keys = std::array<uint64_t, kMaxCellCount>;
+
+	Keys killer;
+	std::array<Keys, kDudeVariantCount> dudes;
+	Keys mines;
+	uint64_t light;
+
+	static int cellForPos(const Pos & pos) noexcept
+	{
+		assert(pos.x >= 0 && pos.x < kMaxMapSize && pos.y >= 0 && pos.y < kMaxMapSize);
+		return pos.y * kMaxMapSize + pos.x;
+	}
+
+	static int variantForDude(const Dude & dude) noexcept
+	{
+		switch (dude.type) {
+		case Dude::Type::Victim: return 0;
+		case Dude::Type::Cat:    return 1;
+		case Dude::Type::Cop:    return 2 + int(dude.dir);
+		case Dude::Type::Swat:   return 6 + int(dude.dir);
+		case Dude::Type::Drop:   return 10 + int(dude.orientation);
+		}
+		assert(false);
+		__builtin_unreachable();
+	}
+
+	uint64_t forKiller(const Pos & pos) const noexcept { return killer[cellForPos(pos)]; }
+	uint64_t forDude(const Dude & dude) const noexcept { return dudes[variantForDude(dude)][cellForPos(dude.pos)]; }
+	uint64_t forMine(const Mine & mine) const noexcept { return mines[cellForPos(mine.pos)]; }
+};
+
+
+inline constexpr Zobrist kZobrist = [] () -> Zobrist {
+	uint64_t seed = 0x736c617961776179;
+	const auto next = [&seed] () -> uint64_t {
+		// splitmix64
+		uint64_t z = (seed += 0x9e3779b97f4a7c15);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	};
+	Zobrist zobrist {};
+	for (uint64_t & key : zobrist.killer) key = next();
+	for (Zobrist::Keys & keys : zobrist.dudes) {
+		for (uint64_t & key : keys) key = next();
+	}
+	for (uint64_t & key : zobrist.mines) key = next();
+	zobrist.light = next();
+	return zobrist;
+}();
+
+
+
+
 struct State {
 	Killer killer;
 	std::vector<Dude> dudes;
 	std::vector<Mine> mines;
 	bool light = true;
+	uint64_t key = 0;
 
 	const auto findDude(const Pos & pos) const noexcept
 	{
@@ -121,22 +201,77 @@ struct State {
 		return false;
 	}
 
+	void setKillerPos(const Pos & pos) noexcept
+	{
+		key ^= kZobrist.forKiller(killer.pos) ^ kZobrist.forKiller(pos);
+		killer.pos = pos;
+	}
+
+	void toggleLight() noexcept
+	{
+		key ^= kZobrist.light;
+		light = !light;
+	}
+
+	void removeMine(std::vector<Mine>::const_iterator it) noexcept
+	{
+		key ^= kZobrist.forMine(*it);
+		mines.erase(it);
+	}
+
+	void removeDude(std::vector<Dude>::const_iterator it) noexcept
+	{
+		key ^= kZobrist.forDude(*it);
+		dudes.erase(it);
+	}
+
 	void moveDude(const Dude & dude, Dude && target) noexcept
 	{
 		{
 			const auto it = std::find(dudes.begin(), dudes.end(), dude);
 			assert(it != dudes.end());
+			key ^= kZobrist.forDude(*it);
 			dudes.erase(it);
 		}
 
+		key ^= kZobrist.forDude(target);
+
 		const auto it = std::find_if(dudes.begin(), dudes.end(), [&target] (const Dude & d) {
 			return target < d;
 		});
 		dudes.insert(it, std::move(target));
 	}
 
+	uint64_t calculateKey() const noexcept
+	{
+		uint64_t k = kZobrist.forKiller(killer.pos);
+		for (const Dude & dude : dudes) {
+			k ^= kZobrist.forDude(dude);
+		}
+		for (const Mine & mine : mines) {
+			k ^= kZobrist.forMine(mine);
+		}
+		if (light) {
+			k ^= kZobrist.light;
+		}
+		return k;
+	}
+
+	std::size_t calculateHash() const noexcept
+	{
+		std::size_t hash = std::hash<Pos>{}(killer.pos);
+		for (const Dude & dude : dudes) {
+			hash = combineHash(hash, std::hash<Dude>{}(dude));
+		}
+		for (const Mine & mine : mines) {
+			hash = combineHash(hash, std::hash<Pos>{}(mine.pos));
+		}
+		return combineHash(hash, light);
+	}
+
 	bool operator==(const State & other) const noexcept
 	{
+		if (key != other.key) return false;
 		if (killer != other.killer) return false;
 		if (dudes != other.dudes) return false;
 		if (mines != other.mines) return false;
@@ -146,40 +281,10 @@ struct State {
 };
 
 
-struct Hash {
-	std::size_t sum = 0;
-	int index = 0;
-
-	template <typename T>
-	void operator()(const T & v) noexcept
-	{
-		sum ^= (std::hash<T>{}(v) << index);
-		index++;
-		if (index == sizeof(sum)) index = 0;
-	};
-};
-
-
 template<>
 struct std::hash<State> {
 	std::size_t operator()(const State & state) const noexcept
 	{
-		Hash hash;
-		hash(state.killer.pos);
-		for (const Dude & dude : state.dudes) {
-			hash(dude.type);
-			hash(dude.pos);
-			if (dude.type == Dude::Type::Cop || dude.type == Dude::Type::Swat) {
-				hash(dude.dir);
-			}
-			if (dude.type == Dude::Type::Drop) {
-				hash(dude.orientation);
-			}
-		}
-		for (const Mine & mine : state.mines) {
-			hash(mine.pos);
-		}
-		hash(state.light);
-		return hash.sum;
+		return state.key;
 	}
 };
@@ -0,0 +1,72 @@
+#include "StateTable.hpp"
+
+#include <cassert>
+
+
+
+
+StateTable::StateTable() :
+	controls_(kGroupSize, kEmpty),
+	slots_(kGroupSize)
+{
+}
+
+
+void StateTable::insert(const uint64_t hash, const int id) noexcept
+{
+	// keep at most 7/8 of the slots taken, so every probe sequence meets an empty slot
+	if ((size_ + 1) * 8 > capacity() * 7) {
+		_grow();
+	}
+	_insert(_fingerprintForHash(hash), id);
+	size_++;
+}
+
+
+void StateTable::_insert(const uint32_t fingerprint, const int id) noexcept
+{
+	for (int group = _homeGroup(fingerprint);; group = (group + 1) & _groupMask()) {
+		const uint32_t mask = _matchGroup(group, kEmpty);
+		if (mask != 0) {
+			const int index = group * kGroupSize + __builtin_ctz(mask);
+			controls_[index] = _controlForFingerprint(fingerprint);
+			slots_[index] = Slot {
+				.fingerprint = fingerprint,
+				.id = id,
+			};
+			return;
+		}
+	}
+}
+
+
+void StateTable::_grow() noexcept
+{
+	std::vector<uint8_t> controls(capacity() * 2, kEmpty);
+	std::vector<Slot> slots(capacity() * 2);
+	std::swap(controls_, controls);
+	std::swap(slots_, slots);
+
+	for (int i = 0; i < int(controls.size()); ++i) {
+		if (controls[i] != kEmpty) {
+			_insert(slots[i].fingerprint, slots[i].id);
+		}
+	}
+}
+
+
+double StateTable::averageProbeLength() const noexcept
+{
+	if (size_ == 0) {
+		return 0;
+	}
+
+	// groups a successful lookup visits, counting the home group
+	int64_t probes = 0;
+	for (int i = 0; i < capacity(); ++i) {
+		if (controls_[i] == kEmpty) continue;
+		const int group = i / kGroupSize;
+		probes += ((group - _homeGroup(slots_[i].fingerprint)) & _groupMask()) + 1;
+	}
+	return double(probes) / size_;
+}
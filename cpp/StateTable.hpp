@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+
+
+// Open addressing set of ids, probed a group of 16 control bytes at a time.
+// The table only keeps a hash fingerprint per id, so the caller resolves equality by id.
+class StateTable {
+public:
+	StateTable();
+
+	template <typename Equal>
+	int find(uint64_t hash, const Equal & equal) const noexcept;
+
+	// returns the id of an equal entry, or inserts the given id and returns -1
+	template <typename Equal>
+	int findOrInsert(uint64_t hash, int id, const Equal & equal) noexcept;
+
+	void insert(uint64_t hash, int id) noexcept;
+
+	int size() const noexcept { return size_; }
+	int capacity() const noexcept { return int(controls_.size()); }
+	double loadFactor() const noexcept { return double(size_) / capacity(); }
+	double averageProbeLength() const noexcept;
+
+private:
+	static constexpr int kGroupSize = 16;
+	static constexpr uint8_t kEmpty = 0x80;
+
+	struct Slot {
+		uint32_t fingerprint;
+		int id;
+	};
+
+	static uint32_t _fingerprintForHash(uint64_t hash) noexcept { return uint32_t(hash); }
+	static uint8_t _controlForFingerprint(uint32_t fingerprint) noexcept { return fingerprint & 0x7f; }
+
+	int _groupMask() const noexcept { return capacity() / kGroupSize - 1; }
+	int _homeGroup(uint32_t fingerprint) const noexcept { return (fingerprint >> 7) & _groupMask(); }
+
+	uint32_t _matchGroup(int group, uint8_t control) const noexcept;
+	void _insert(uint32_t fingerprint, int id) noexcept;
+	void _grow() noexcept;
+
+	std::vector<uint8_t> controls_;
+	std::vector<Slot> slots_;
+	int size_ = 0;
+};
+
+
+
+
+inline uint32_t StateTable::_matchGroup(const int group, const uint8_t control) const noexcept
+{
+	const uint8_t * const controls = controls_.data() + group * kGroupSize;
+#ifdef __SSE2__
+	const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(controls));
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(char(control))));
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < kGroupSize; ++i) {
+		if (controls[i] == control) mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+
+template <typename Equal>
+inline int StateTable::find(const uint64_t hash, const Equal & equal) const noexcept
+{
+	const uint32_t fingerprint = _fingerprintForHash(hash);
+	const uint8_t control = _controlForFingerprint(fingerprint);
+
+	for (int group = _homeGroup(fingerprint);; group = (group + 1) & _groupMask()) {
+		for (uint32_t mask = _matchGroup(group, control); mask != 0; mask &= mask - 1) {
+			const Slot & slot = slots_[group * kGroupSize + __builtin_ctz(mask)];
+			if (slot.fingerprint == fingerprint && equal(slot.id)) {
+				return slot.id;
+			}
+		}
+		if (_matchGroup(group, kEmpty) != 0) {
+			return -1;
+		}
+	}
+}
+
+
+template <typename Equal>
+inline int StateTable::findOrInsert(const uint64_t hash, const int id, const Equal & equal) noexcept
+{
+	const int existingId = find(hash, equal);
+	if (existingId != -1) {
+		return existingId;
+	}
+	insert(hash, id);
+	return -1;
+}
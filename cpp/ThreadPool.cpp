@@ -0,0 +1,92 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+
+
+
+ThreadPool::ThreadPool(const int threadCount) :
+	threadCount_(std::max(1, threadCount))
+{
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		const std::lock_guard lock(mutex_);
+		quit_ = true;
+	}
+	wake_.notify_all();
+
+	for (std::thread & thread : threads_) {
+		thread.join();
+	}
+}
+
+
+void ThreadPool::run(const int count, const std::function<void(int index)> & func)
+{
+	if (threadCount_ == 1 || count <= 1) {
+		for (int index = 0; index < count; ++index) {
+			func(index);
+		}
+		return;
+	}
+
+	if (threads_.empty()) {
+		threads_.reserve(threadCount_ - 1);
+		for (int i = 0; i < threadCount_ - 1; ++i) {
+			threads_.emplace_back(&ThreadPool::_work, this);
+		}
+	}
+
+	{
+		const std::lock_guard lock(mutex_);
+		func_ = &func;
+		count_ = count;
+		nextIndex_ = 0;
+		busyCount_ = threads_.size();
+		batch_++;
+	}
+	wake_.notify_all();
+
+	_take();
+
+	// every thread has to be done with the batch before the next one may start
+	std::unique_lock lock(mutex_);
+	done_.wait(lock, [this] { return busyCount_ == 0; });
+	func_ = nullptr;
+}
+
+
+void ThreadPool::_work()
+{
+	int batch = 0;
+
+	while (true) {
+		{
+			std::unique_lock lock(mutex_);
+			wake_.wait(lock, [this, batch] { return quit_ || batch_ != batch; });
+			if (quit_) return;
+			batch = batch_;
+		}
+
+		_take();
+
+		const std::lock_guard lock(mutex_);
+		if (--busyCount_ == 0) {
+			done_.notify_one();
+		}
+	}
+}
+
+
+void ThreadPool::_take()
+{
+	while (true) {
+		const int index = nextIndex_++;
+		if (index >= count_) break;
+		(*func_)(index);
+	}
+}
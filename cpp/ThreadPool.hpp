@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+
+// Threads kept for the life of a solver and woken for each batch of work, so that a search running many small
+// parallel steps does not start and join threads for every one of them. The threads are started on the first
+// batch only, so that a solver which never runs one, like a coordinator forking its worker processes, has none.
+class ThreadPool {
+public:
+	// runs batches on threadCount threads, the calling one included
+	explicit ThreadPool(int threadCount);
+	// wakes the threads to quit and joins them
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+
+	// calls func for every index below count, spread over the threads, and returns once all calls returned
+	void run(int count, const std::function<void(int index)> & func);
+
+private:
+	void _work();
+	// calls func for the indices left, whichever thread takes them
+	void _take();
+
+	const int threadCount_;
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	int batch_ = 0; // counts the batches, a thread waits for the next one
+	int busyCount_ = 0; // threads not done with the current batch
+	bool quit_ = false;
+
+	// the current batch
+	const std::function<void(int index)> * func_ = nullptr;
+	int count_ = 0;
+	std::atomic<int> nextIndex_ = 0;
+};
@@ -0,0 +1,30 @@
+#include "TranspositionTable.hpp"
+
+
+
+
+TranspositionTable::TranspositionTable(const int bits) :
+	mask_((uint64_t(1) << bits) - 1),
+	slots_(std::make_unique<std::atomic<uint64_t>[]>(size_t(1) << bits))
+{
+	_clear();
+}
+
+
+void TranspositionTable::startGeneration() noexcept
+{
+	generation_ = (generation_ + 1) & (kLowMask >> kGenerationShift);
+	if (generation_ == 0) {
+		// old slots would pass for new ones
+		_clear();
+		generation_ = 1;
+	}
+}
+
+
+void TranspositionTable::_clear() noexcept
+{
+	for (uint64_t i = 0; i <= mask_; ++i) {
+		slots_[i].store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,53 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+
+
+
+// Fixed-size table of the depths states were reached at, shared by the threads of a depth-first search.
+// A slot holds a single state and is overwritten by any other one, so the table only ever forgets states;
+// a state's key is told apart by its slot and by the high bits kept in it. Slots of an earlier generation
+// count as empty, which saves clearing the whole table for every search.
+class TranspositionTable {
+public:
+	// 1 << bits slots, 8 bytes each
+	explicit TranspositionTable(int bits);
+
+	// forgets every state
+	void startGeneration() noexcept;
+
+	// whether key was reached before at no more than depth; otherwise it is now, at depth
+	bool visit(uint64_t key, int depth) noexcept;
+
+private:
+	// the low bits of a slot hold the generation and the depth, generation zero is never used
+	static constexpr int kGenerationShift = 16;
+	static constexpr uint64_t kDepthMask = 0xffff;
+	static constexpr uint64_t kLowMask = 0xffffff;
+
+	void _clear() noexcept;
+
+	const uint64_t mask_;
+	std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+	uint64_t generation_ = 0;
+};
+
+
+
+
+inline bool TranspositionTable::visit(const uint64_t key, const int depth) noexcept
+{
+	// racing threads can each take the state, which only costs a subtree searched twice
+	std::atomic<uint64_t> & slot = slots_[key & mask_];
+	const uint64_t tag = (key & ~kLowMask) | generation_ << kGenerationShift;
+	const uint64_t entry = slot.load(std::memory_order_relaxed);
+	if ((entry & ~kDepthMask) == tag && int(entry & kDepthMask) <= depth) {
+		return true;
+	}
+	slot.store(tag | uint64_t(depth), std::memory_order_relaxed);
+	return false;
+}
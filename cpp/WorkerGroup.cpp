@@ -0,0 +1,326 @@
+#include "WorkerGroup.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+
+
+namespace {
+
+
+void writeAll(const int fd, const void * const data, const size_t size)
+{
+	const uint8_t * const bytes = static_cast<const uint8_t *>(data);
+	for (size_t offset = 0; offset < size;) {
+		const ssize_t written = write(fd, bytes + offset, size - offset);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			throw std::system_error(errno, std::generic_category(), "write");
+		}
+		offset += written;
+	}
+}
+
+
+void readAll(const int fd, void * const data, const size_t size)
+{
+	uint8_t * const bytes = static_cast<uint8_t *>(data);
+	for (size_t offset = 0; offset < size;) {
+		const ssize_t read = ::read(fd, bytes + offset, size - offset);
+		if (read < 0) {
+			if (errno == EINTR) continue;
+			throw std::system_error(errno, std::generic_category(), "read");
+		}
+		if (read == 0) {
+			throw std::runtime_error("Worker pipe closed");
+		}
+		offset += read;
+	}
+}
+
+
+std::array<int, 2> makePipe()
+{
+	std::array<int, 2> fds;
+	if (pipe(fds.data()) != 0) {
+		throw std::system_error(errno, std::generic_category(), "pipe");
+	}
+	return fds;
+}
+
+
+void setNonBlocking(const int fd)
+{
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+		throw std::system_error(errno, std::generic_category(), "fcntl");
+	}
+}
+
+
+}
+
+
+
+
+WorkerGroup::WorkerGroup(const int workerCount, const std::function<void(Link & link)> & work)
+{
+	// peerPipes[from][to] carries the batches one worker posts to another
+	std::vector<std::vector<std::array<int, 2>>> peerPipes(workerCount,
+			std::vector<std::array<int, 2>>(workerCount, {-1, -1}));
+	std::vector<std::array<int, 2>> toWorker(workerCount);
+	std::vector<std::array<int, 2>> fromWorker(workerCount);
+	std::vector<int> fds;
+
+	for (int from = 0; from < workerCount; ++from) {
+		for (int to = 0; to < workerCount; ++to) {
+			if (from == to) continue;
+			peerPipes[from][to] = makePipe();
+			fds.insert(fds.end(), peerPipes[from][to].begin(), peerPipes[from][to].end());
+		}
+		toWorker[from] = makePipe();
+		fromWorker[from] = makePipe();
+		fds.insert(fds.end(), toWorker[from].begin(), toWorker[from].end());
+		fds.insert(fds.end(), fromWorker[from].begin(), fromWorker[from].end());
+	}
+
+	// or the workers would print it again
+	fflush(stdout);
+	fflush(stderr);
+
+	for (int index = 0; index < workerCount; ++index) {
+		const int pid = fork();
+		if (pid < 0) {
+			throw std::system_error(errno, std::generic_category(), "fork");
+		}
+
+		if (pid == 0) {
+			Link link;
+			link.index_ = index;
+			link.readFd_ = toWorker[index][0];
+			link.writeFd_ = fromWorker[index][1];
+			link.peers_.resize(workerCount);
+			std::vector<int> keptFds = {link.readFd_, link.writeFd_};
+			for (int peer = 0; peer < workerCount; ++peer) {
+				if (peer == index) continue;
+				link.peers_[peer].readFd = peerPipes[peer][index][0];
+				link.peers_[peer].writeFd = peerPipes[index][peer][1];
+				setNonBlocking(link.peers_[peer].readFd);
+				setNonBlocking(link.peers_[peer].writeFd);
+				keptFds.push_back(link.peers_[peer].readFd);
+				keptFds.push_back(link.peers_[peer].writeFd);
+			}
+			for (const int fd : fds) {
+				if (std::find(keptFds.begin(), keptFds.end(), fd) == keptFds.end()) {
+					close(fd);
+				}
+			}
+
+			// never returns into the coordinator's code, nor runs its exit handlers
+			int status = 0;
+			try {
+				work(link);
+			} catch (const std::exception & e) {
+				fprintf(stderr, "worker %d: %s\n", index, e.what());
+				status = 1;
+			}
+			fflush(stdout);
+			fflush(stderr);
+			_exit(status);
+		}
+
+		workers_.push_back(Worker {
+			.pid = pid,
+			.readFd = fromWorker[index][0],
+			.writeFd = toWorker[index][1],
+		});
+	}
+
+	for (const int fd : fds) {
+		const bool kept = std::any_of(workers_.begin(), workers_.end(), [fd] (const Worker & worker) {
+			return worker.readFd == fd || worker.writeFd == fd;
+		});
+		if (!kept) {
+			close(fd);
+		}
+	}
+}
+
+
+WorkerGroup::~WorkerGroup()
+{
+	// a worker still waiting for the coordinator reads the end of its pipe
+	for (const Worker & worker : workers_) {
+		close(worker.readFd);
+		close(worker.writeFd);
+	}
+	for (const Worker & worker : workers_) {
+		waitpid(worker.pid, nullptr, 0);
+	}
+}
+
+
+void WorkerGroup::send(const int worker, const void * const data, const size_t size) const
+{
+	writeAll(workers_[worker].writeFd, data, size);
+}
+
+
+void WorkerGroup::receive(const int worker, void * const data, const size_t size) const
+{
+	readAll(workers_[worker].readFd, data, size);
+}
+
+
+void WorkerGroup::Link::send(const void * const data, const size_t size) const
+{
+	writeAll(writeFd_, data, size);
+}
+
+
+void WorkerGroup::Link::receive(void * const data, const size_t size) const
+{
+	readAll(readFd_, data, size);
+}
+
+
+void WorkerGroup::Link::post(const int worker, const void * const data, const size_t size)
+{
+	const uint8_t * const bytes = static_cast<const uint8_t *>(data);
+	if (worker == index_) {
+		peers_[worker].received.insert(peers_[worker].received.end(), bytes, bytes + size);
+		return;
+	}
+
+	// framed by its size, an empty frame ends the exchange
+	const uint32_t frameSize = size;
+	std::vector<uint8_t> & outbox = peers_[worker].outbox;
+	outbox.insert(outbox.end(), reinterpret_cast<const uint8_t *>(&frameSize),
+			reinterpret_cast<const uint8_t *>(&frameSize) + sizeof(frameSize));
+	outbox.insert(outbox.end(), bytes, bytes + size);
+	_pump(false);
+}
+
+
+std::vector<std::vector<uint8_t>> WorkerGroup::Link::finish()
+{
+	static constexpr uint32_t kEndFrame = 0;
+	for (int peer = 0; peer < workerCount(); ++peer) {
+		if (peer == index_) continue;
+		std::vector<uint8_t> & outbox = peers_[peer].outbox;
+		outbox.insert(outbox.end(), reinterpret_cast<const uint8_t *>(&kEndFrame),
+				reinterpret_cast<const uint8_t *>(&kEndFrame) + sizeof(kEndFrame));
+	}
+	peers_[index_].ended = true;
+
+	while (!_done()) {
+		_pump(true);
+	}
+
+	// nothing more comes before the coordinator starts the next exchange
+	std::vector<std::vector<uint8_t>> received(workerCount());
+	for (int peer = 0; peer < workerCount(); ++peer) {
+		received[peer] = std::move(peers_[peer].received);
+		peers_[peer].received.clear();
+		peers_[peer].ended = false;
+	}
+	return received;
+}
+
+
+void WorkerGroup::Link::_pump(const bool wait)
+{
+	std::vector<pollfd> pollFds;
+	std::vector<int> pollPeers;
+	for (int peer = 0; peer < workerCount(); ++peer) {
+		if (peer == index_) continue;
+		const Peer & p = peers_[peer];
+		if (p.outboxOffset < p.outbox.size()) {
+			pollFds.push_back(pollfd {.fd = p.writeFd, .events = POLLOUT, .revents = 0});
+			pollPeers.push_back(peer);
+		}
+		if (!p.ended) {
+			pollFds.push_back(pollfd {.fd = p.readFd, .events = POLLIN, .revents = 0});
+			pollPeers.push_back(peer);
+		}
+	}
+	if (pollFds.empty()) {
+		return;
+	}
+
+	if (poll(pollFds.data(), pollFds.size(), wait ? -1 : 0) < 0) {
+		if (errno == EINTR) return;
+		throw std::system_error(errno, std::generic_category(), "poll");
+	}
+
+	for (int i = 0; i < int(pollFds.size()); ++i) {
+		if (pollFds[i].revents == 0) continue;
+		Peer & p = peers_[pollPeers[i]];
+
+		if (pollFds[i].fd == p.writeFd) {
+			while (p.outboxOffset < p.outbox.size()) {
+				const ssize_t written = write(p.writeFd, p.outbox.data() + p.outboxOffset,
+						p.outbox.size() - p.outboxOffset);
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					if (errno == EAGAIN) break;
+					throw std::system_error(errno, std::generic_category(), "write");
+				}
+				p.outboxOffset += written;
+			}
+			if (p.outboxOffset == p.outbox.size()) {
+				p.outbox.clear();
+				p.outboxOffset = 0;
+			}
+			continue;
+		}
+
+		std::array<uint8_t, 1 << 16> buffer;
+		while (true) {
+			const ssize_t read = ::read(p.readFd, buffer.data(), buffer.size());
+			if (read < 0) {
+				if (errno == EINTR) continue;
+				if (errno == EAGAIN) break;
+				throw std::system_error(errno, std::generic_category(), "read");
+			}
+			if (read == 0) {
+				throw std::runtime_error("Worker pipe closed");
+			}
+			p.inbox.insert(p.inbox.end(), buffer.begin(), buffer.begin() + read);
+		}
+
+		size_t offset = 0;
+		while (p.inbox.size() - offset >= sizeof(uint32_t)) {
+			uint32_t frameSize;
+			std::memcpy(&frameSize, p.inbox.data() + offset, sizeof(frameSize));
+			if (frameSize == 0) {
+				p.ended = true;
+				offset += sizeof(frameSize);
+				break;
+			}
+			if (p.inbox.size() - offset - sizeof(frameSize) < frameSize) break;
+			const uint8_t * const frame = p.inbox.data() + offset + sizeof(frameSize);
+			p.received.insert(p.received.end(), frame, frame + frameSize);
+			offset += sizeof(frameSize) + frameSize;
+		}
+		p.inbox.erase(p.inbox.begin(), p.inbox.begin() + offset);
+	}
+}
+
+
+bool WorkerGroup::Link::_done() const noexcept
+{
+	return std::all_of(peers_.begin(), peers_.end(), [] (const Peer & p) {
+		return p.ended && p.outboxOffset == p.outbox.size();
+	});
+}
@@ -0,0 +1,96 @@
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+
+
+// Worker processes forked from the solver, for searches that spread their states over the memory of several
+// processes. The parent goes on as the coordinator. Each worker has a pipe pair to the coordinator and a pipe to
+// every other worker; nothing else is shared, and nothing leaves the machine.
+class WorkerGroup {
+public:
+	// the ends of the pipes a worker holds
+	class Link {
+	public:
+		int index() const noexcept { return index_; }
+		int workerCount() const noexcept { return int(peers_.size()); }
+
+		// to and from the coordinator, blocking
+		void send(const void * data, size_t size) const;
+		void receive(void * data, size_t size) const;
+
+		template <typename T>
+		void send(const T & value) const { send(&value, sizeof(value)); }
+
+		template <typename T>
+		T receive() const
+		{
+			T value;
+			receive(&value, sizeof(value));
+			return value;
+		}
+
+		// Queues a batch for a worker, possibly this one, and writes what the pipes take without blocking,
+		// reading whatever the others wrote meanwhile, so that workers posting to each other never deadlock.
+		void post(int worker, const void * data, size_t size);
+
+		// ends the exchange and waits for every worker to end theirs; returns what each of them posted to this one
+		std::vector<std::vector<uint8_t>> finish();
+
+	private:
+		friend class WorkerGroup;
+
+		struct Peer {
+			int readFd = -1;
+			int writeFd = -1;
+			std::vector<uint8_t> outbox; // framed batches not written yet
+			size_t outboxOffset = 0;
+			std::vector<uint8_t> inbox; // bytes read, a frame is taken out once it is whole
+			std::vector<uint8_t> received; // the batches taken out
+			bool ended = false;
+		};
+
+		// writes and reads what can be, waiting for the pipes when asked to
+		void _pump(bool wait);
+		bool _done() const noexcept;
+
+		int index_ = 0;
+		int readFd_ = -1;
+		int writeFd_ = -1;
+		std::vector<Peer> peers_;
+	};
+
+	// forks the workers, each running work and exiting once it returns
+	WorkerGroup(int workerCount, const std::function<void(Link & link)> & work);
+	// waits for the workers to exit
+	~WorkerGroup();
+
+	int workerCount() const noexcept { return int(workers_.size()); }
+
+	void send(int worker, const void * data, size_t size) const;
+	void receive(int worker, void * data, size_t size) const;
+
+	template <typename T>
+	void send(const int worker, const T & value) const { send(worker, &value, sizeof(value)); }
+
+	template <typename T>
+	T receive(const int worker) const
+	{
+		T value;
+		receive(worker, &value, sizeof(value));
+		return value;
+	}
+
+private:
+	struct Worker {
+		int pid = -1;
+		int readFd = -1;
+		int writeFd = -1;
+	};
+
+	std::vector<Worker> workers_;
+};
@@ -0,0 +1,209 @@
+#include "WorkingState.hpp"
+
+
+
+
+WorkingState::WorkingState(const State & state) noexcept
+{
+	load(state);
+}
+
+
+void WorkingState::load(const State & state) noexcept
+{
+	static_assert(kMaxDudeCount < kNoSlot);
+	assert(!undoLog_);
+
+	killer_ = state.killer;
+	dudeCount_ = state.dudes.size();
+	mineCount_ = state.mines.size();
+	light_ = state.light;
+	key_ = state.key;
+	assert(dudeCount_ <= kMaxDudeCount);
+	assert(mineCount_ <= kMaxMineCount);
+
+	mineCells_ = {};
+	occupiedInRow_ = {};
+	occupiedInColumn_ = {};
+	countForType_ = {};
+	hasDangerMap_ = false;
+
+	std::copy(state.dudes.begin(), state.dudes.end(), dudes_.begin());
+	std::copy(state.mines.begin(), state.mines.end(), mines_.begin());
+
+	// slots are read only for occupied cells, so the grid is left as it is elsewhere
+	for (int i = 0; i < mineCount_; ++i) {
+		const Mine & mine = mines_[i];
+		slotForCell_[Zobrist::cellForPos(mine.pos)] = kNoSlot;
+		mineCells_.set(Zobrist::cellForPos(mine.pos));
+		_occupy(mine.pos);
+	}
+
+	for (int slot = 0; slot < dudeCount_; ++slot) {
+		const Dude & dude = dudes_[slot];
+		slotForCell_[Zobrist::cellForPos(dude.pos)] = slot;
+		_placeDude(dude);
+	}
+}
+
+
+void WorkingState::commit(State & state) const
+{
+	// assigning keeps the capacity of the vectors, so a reused state does not allocate
+	state.killer = killer_;
+	state.light = light_;
+	state.key = key_;
+	state.mines.assign(mines_.begin(), mines_.begin() + mineCount_);
+
+	// slots get shuffled by removals and moves, the canonical order is by position
+	state.dudes.assign(dudes_.begin(), dudes_.begin() + dudeCount_);
+	std::sort(state.dudes.begin(), state.dudes.end());
+}
+
+
+void WorkingState::removeMine(const Pos & pos) noexcept
+{
+	const auto end = mines_.begin() + mineCount_;
+	const auto it = std::find(mines_.begin(), end, Mine{pos});
+	assert(it != end);
+	_record(UndoLog::Entry {
+		.type = UndoLog::Entry::Type::RemoveMine,
+		.index = uint8_t(it - mines_.begin()),
+		.pos = pos,
+	});
+	key_ ^= kZobrist.forMine(*it);
+	mineCells_.reset(Zobrist::cellForPos(pos));
+	_vacate(pos);
+	std::copy(it + 1, end, it);
+	mineCount_--;
+}
+
+
+void WorkingState::removeDude(const Pos & pos) noexcept
+{
+	const int cell = Zobrist::cellForPos(pos);
+	const uint8_t slot = slotForCell_[cell];
+	assert(slot != kNoSlot);
+
+	const Dude & dude = dudes_[slot];
+	_record(UndoLog::Entry {
+		.type = UndoLog::Entry::Type::RemoveDude,
+		.index = slot,
+		.dude = dude,
+	});
+	_dudeChanged(dude);
+	key_ ^= kZobrist.forDude(dude);
+	_unplaceDude(dude);
+	slotForCell_[cell] = kNoSlot;
+
+	// fill the hole with the last dude
+	dudeCount_--;
+	if (slot != dudeCount_) {
+		dudes_[slot] = dudes_[dudeCount_];
+		slotForCell_[Zobrist::cellForPos(dudes_[slot].pos)] = slot;
+	}
+}
+
+
+void WorkingState::moveDude(const Dude & dude, Dude && target) noexcept
+{
+	const int cell = Zobrist::cellForPos(dude.pos);
+	const uint8_t slot = slotForCell_[cell];
+	assert(slot != kNoSlot);
+	assert(dudes_[slot] == dude);
+
+	const int targetCell = Zobrist::cellForPos(target.pos);
+	assert(targetCell == cell || !findDude(target.pos));
+
+	_record(UndoLog::Entry {
+		.type = UndoLog::Entry::Type::MoveDude,
+		.index = slot,
+		.dude = dudes_[slot],
+	});
+	_dudeChanged(dudes_[slot]);
+	_dudeChanged(target);
+	key_ ^= kZobrist.forDude(dudes_[slot]) ^ kZobrist.forDude(target);
+	_unplaceDude(dudes_[slot]);
+	_placeDude(target);
+
+	slotForCell_[cell] = kNoSlot;
+	slotForCell_[targetCell] = slot;
+	dudes_[slot] = std::move(target);
+}
+
+
+void WorkingState::startRecording(UndoLog & log) noexcept
+{
+	log.killer_ = killer_;
+	log.light_ = light_;
+	log.key_ = key_;
+	log.hasDangerMap_ = hasDangerMap_;
+	log.savesDangerMap_ = false;
+	log.entryCount_ = 0;
+	undoLog_ = &log;
+}
+
+
+void WorkingState::undo(const UndoLog & log) noexcept
+{
+	assert(!undoLog_);
+
+	for (int i = log.entryCount_ - 1; i >= 0; --i) {
+		const UndoLog::Entry & entry = log.entries_[i];
+
+		switch (entry.type) {
+		case UndoLog::Entry::Type::MoveDude: {
+			const Dude & moved = dudes_[entry.index];
+			_unplaceDude(moved);
+			slotForCell_[Zobrist::cellForPos(moved.pos)] = kNoSlot;
+
+			dudes_[entry.index] = entry.dude;
+			_placeDude(entry.dude);
+			slotForCell_[Zobrist::cellForPos(entry.dude.pos)] = entry.index;
+		}
+			break;
+
+		case UndoLog::Entry::Type::RemoveDude: {
+			// the last dude filled the hole, so it goes back to the end
+			if (entry.index != dudeCount_) {
+				dudes_[dudeCount_] = dudes_[entry.index];
+				slotForCell_[Zobrist::cellForPos(dudes_[dudeCount_].pos)] = dudeCount_;
+			}
+			dudeCount_++;
+
+			dudes_[entry.index] = entry.dude;
+			_placeDude(entry.dude);
+			slotForCell_[Zobrist::cellForPos(entry.dude.pos)] = entry.index;
+		}
+			break;
+
+		case UndoLog::Entry::Type::RemoveMine: {
+			const auto it = mines_.begin() + entry.index;
+			std::copy_backward(it, mines_.begin() + mineCount_, mines_.begin() + mineCount_ + 1);
+			*it = Mine{entry.pos};
+			mineCount_++;
+			mineCells_.set(Zobrist::cellForPos(entry.pos));
+			_occupy(entry.pos);
+		}
+			break;
+		}
+	}
+
+	killer_ = log.killer_;
+	light_ = log.light_;
+	key_ = log.key_;
+	if (log.savesDangerMap_) {
+		dangerMap_ = log.dangerMap_;
+	}
+	hasDangerMap_ = log.hasDangerMap_;
+}
+
+
+void WorkingState::_record(UndoLog::Entry && entry) noexcept
+{
+	if (!undoLog_) {
+		return;
+	}
+	assert(undoLog_->entryCount_ < UndoLog::kMaxEntryCount);
+	undoLog_->entries_[undoLog_->entryCount_++] = std::move(entry);
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <bitset>
+#include <span>
+
+#include "State.hpp"
+
+
+
+
+// Cells a cop or a swat would shoot the killer at. Only Player knows the map to build it,
+// the state drops it whenever a cop, a swat or a dude in a swat line of fire changes.
+struct DangerMap {
+	std::bitset<kMaxCellCount> cops; // deadly only while the light is on
+	std::bitset<kMaxCellCount> swats;
+	std::bitset<kMaxCellCount> swatBlockers; // swat lines of fire and the dudes cutting them
+};
+
+
+
+
+// Changes made to a WorkingState while it records them, so that they can be reverted.
+class UndoLog {
+public:
+	void clear() noexcept { entryCount_ = 0; }
+
+private:
+	friend class WorkingState;
+
+	static constexpr int kMaxEntryCount = kMaxDudeCount * 8;
+
+	struct Entry {
+		enum class Type : uint8_t {
+			MoveDude,
+			RemoveDude,
+			RemoveMine,
+		};
+
+		Type type;
+		uint8_t index; // dude slot or mine index
+		Dude dude {}; // the dude before the change
+		Pos pos {}; // the removed mine
+	};
+
+	Killer killer_;
+	bool light_;
+	uint64_t key_;
+	bool hasDangerMap_;
+	bool savesDangerMap_; // the danger map is saved only once a step replaces it
+	DangerMap dangerMap_;
+	std::array<Entry, kMaxEntryCount> entries_;
+	int entryCount_ = 0;
+};
+
+
+
+
+// State as Player mutates it: dudes stay unordered and are found through a grid of slots.
+// The canonical sorted State is produced only by commit(). Everything is kept inline, so copies never allocate.
+class WorkingState {
+public:
+	WorkingState() = default;
+	explicit WorkingState(const State & state) noexcept;
+
+	// starts over from state, reusing the storage of the grids
+	void load(const State & state) noexcept;
+	void commit(State & state) const;
+
+	// records every following change into the log, until stopped
+	void startRecording(UndoLog & log) noexcept;
+	void stopRecording() noexcept { undoLog_ = nullptr; }
+	void undo(const UndoLog & log) noexcept;
+
+	const Killer & killer() const noexcept { return killer_; }
+	bool light() const noexcept { return light_; }
+	uint64_t key() const noexcept { return key_; }
+
+	std::span<const Dude> dudes() const noexcept { return {dudes_.data(), size_t(dudeCount_)}; }
+	int countForType(const Dude::Type type) const noexcept { return countForType_[int(type)]; }
+	bool hasVictims() const noexcept { return countForType(Dude::Type::Victim) != 0; }
+
+	const Dude * findDude(const Pos & pos) const noexcept;
+	const Dude & getDude(const Pos & pos) const noexcept;
+	bool hasMine(const Pos & pos) const noexcept;
+
+	// count of cells free of dudes and mines next to pos in dir, up to maxCount
+	int freeCount(const Pos & pos, Dir dir, int maxCount) const noexcept;
+
+	bool hasDangerMap() const noexcept { return hasDangerMap_; }
+	const DangerMap & dangerMap() const noexcept { assert(hasDangerMap_); return dangerMap_; }
+	void setDangerMap(const DangerMap & dangerMap) noexcept;
+
+	void setKillerPos(const Pos & pos) noexcept;
+	void toggleLight() noexcept;
+	void removeMine(const Pos & pos) noexcept;
+	void removeDude(const Pos & pos) noexcept;
+	void moveDude(const Dude & dude, Dude && target) noexcept;
+
+private:
+	static constexpr uint8_t kNoSlot = 0xff;
+	static constexpr int kDudeTypeCount = 5;
+
+	static bool _isOnGrid(const Pos & pos) noexcept;
+
+	bool _isOccupied(const Pos & pos) const noexcept;
+	void _occupy(const Pos & pos) noexcept;
+	void _vacate(const Pos & pos) noexcept;
+	void _placeDude(const Dude & dude) noexcept;
+	void _unplaceDude(const Dude & dude) noexcept;
+	void _record(UndoLog::Entry && entry) noexcept;
+	void _dudeChanged(const Dude & dude) noexcept;
+
+	Killer killer_;
+	std::array<Dude, kMaxDudeCount> dudes_;
+	std::array<Mine, kMaxMineCount> mines_;
+	int dudeCount_ = 0;
+	int mineCount_ = 0;
+	bool light_ = true;
+	uint64_t key_ = 0;
+
+	std::array<uint8_t, kMaxCellCount> slotForCell_; // only meaningful for occupied cells, kNoSlot under a lone mine
+	std::bitset<kMaxCellCount> mineCells_;
+	std::array<uint32_t, kMaxMapSize> occupiedInRow_ {}; // bit x for a dude or mine at (x, row)
+	std::array<uint32_t, kMaxMapSize> occupiedInColumn_ {}; // bit y for a dude or mine at (column, y)
+	std::array<int, kDudeTypeCount> countForType_ {};
+
+	DangerMap dangerMap_;
+	bool hasDangerMap_ = false;
+
+	UndoLog * undoLog_ = nullptr;
+};
+
+
+
+
+inline bool WorkingState::_isOnGrid(const Pos & pos) noexcept
+{
+	return unsigned(pos.x) < unsigned(kMaxMapSize) && unsigned(pos.y) < unsigned(kMaxMapSize);
+}
+
+
+inline const Dude * WorkingState::findDude(const Pos & pos) const noexcept
+{
+	if (!_isOccupied(pos)) {
+		return nullptr;
+	}
+	const uint8_t slot = slotForCell_[Zobrist::cellForPos(pos)];
+	return slot == kNoSlot ? nullptr : &dudes_[slot];
+}
+
+
+inline const Dude & WorkingState::getDude(const Pos & pos) const noexcept
+{
+	const Dude * const dude = findDude(pos);
+	assert(dude);
+	return *dude;
+}
+
+
+inline bool WorkingState::hasMine(const Pos & pos) const noexcept
+{
+	return _isOnGrid(pos) && mineCells_[Zobrist::cellForPos(pos)];
+}
+
+
+inline int WorkingState::freeCount(const Pos & pos, const Dir dir, const int maxCount) const noexcept
+{
+	static_assert(kMaxMapSize <= 32);
+
+	if (maxCount == 0) {
+		return 0;
+	}
+
+	switch (dir) {
+	case Dir::Left: {
+		const uint32_t before = occupiedInRow_[pos.y] & ((1u << pos.x) - 1);
+		return before == 0 ? maxCount : std::min(maxCount, pos.x - 1 - (31 - __builtin_clz(before)));
+	}
+	case Dir::Right: {
+		const uint64_t after = uint64_t(occupiedInRow_[pos.y]) >> (pos.x + 1);
+		return after == 0 ? maxCount : std::min(maxCount, __builtin_ctz(after));
+	}
+	case Dir::Up: {
+		const uint32_t before = occupiedInColumn_[pos.x] & ((1u << pos.y) - 1);
+		return before == 0 ? maxCount : std::min(maxCount, pos.y - 1 - (31 - __builtin_clz(before)));
+	}
+	case Dir::Down: {
+		const uint64_t after = uint64_t(occupiedInColumn_[pos.x]) >> (pos.y + 1);
+		return after == 0 ? maxCount : std::min(maxCount, __builtin_ctz(after));
+	}
+	}
+	assert(false);
+	__builtin_unreachable();
+}
+
+
+inline bool WorkingState::_isOccupied(const Pos & pos) const noexcept
+{
+	return _isOnGrid(pos) && (occupiedInRow_[pos.y] >> pos.x) & 1;
+}
+
+
+inline void WorkingState::_occupy(const Pos & pos) noexcept
+{
+	occupiedInRow_[pos.y] |= 1u << pos.x;
+	occupiedInColumn_[pos.x] |= 1u << pos.y;
+}
+
+
+inline void WorkingState::_vacate(const Pos & pos) noexcept
+{
+	occupiedInRow_[pos.y] &= ~(1u << pos.x);
+	occupiedInColumn_[pos.x] &= ~(1u << pos.y);
+}
+
+
+inline void WorkingState::_placeDude(const Dude & dude) noexcept
+{
+	countForType_[int(dude.type)]++;
+	_occupy(dude.pos);
+}
+
+
+inline void WorkingState::_unplaceDude(const Dude & dude) noexcept
+{
+	countForType_[int(dude.type)]--;
+	_vacate(dude.pos);
+}
+
+
+inline void WorkingState::setDangerMap(const DangerMap & dangerMap) noexcept
+{
+	if (undoLog_ && !undoLog_->savesDangerMap_) {
+		undoLog_->dangerMap_ = dangerMap_;
+		undoLog_->savesDangerMap_ = true;
+	}
+	dangerMap_ = dangerMap;
+	hasDangerMap_ = true;
+}
+
+
+inline void WorkingState::_dudeChanged(const Dude & dude) noexcept
+{
+	if (!hasDangerMap_) {
+		return;
+	}
+	switch (dude.type) {
+	case Dude::Type::Cop:
+	case Dude::Type::Swat:
+		hasDangerMap_ = false;
+		break;
+	case Dude::Type::Victim:
+	case Dude::Type::Cat:
+	case Dude::Type::Drop:
+		if (dangerMap_.swatBlockers[Zobrist::cellForPos(dude.pos)]) {
+			hasDangerMap_ = false;
+		}
+		break;
+	}
+}
+
+
+inline void WorkingState::setKillerPos(const Pos & pos) noexcept
+{
+	key_ ^= kZobrist.forKiller(killer_.pos) ^ kZobrist.forKiller(pos);
+	killer_.pos = pos;
+}
+
+
+inline void WorkingState::toggleLight() noexcept
+{
+	key_ ^= kZobrist.light;
+	light_ = !light_;
+}
@@ -1,6 +1,8 @@
 
+#include <charconv>
 #include <filesystem>
 #include <stdexcept>
+#include <string_view>
 
 #include "App.hpp"
 
@@ -51,6 +53,24 @@ static App::Args getArgs(const std::string_view & name)
 		};
 	}
 
+	if (name == "hashstats") {
+		return App::Args {
+			.hashStats = true,
+		};
+	}
+
+	if (name == "playerbench") {
+		return App::Args {
+			.playerBench = true,
+		};
+	}
+
+	if (name == "searchstats") {
+		return App::Args {
+			.searchStats = true,
+		};
+	}
+
 	return App::Args {
 		.mapFilePath = [&name] () -> std::filesystem::path {
 			const std::filesystem::path path = name;
@@ -64,13 +84,123 @@ static App::Args getArgs(const std::string_view & name)
 }
 
 
+static int parseThreadCount(const std::string_view & value)
+{
+	int threadCount = 0;
+	const std::from_chars_result r = std::from_chars(value.data(), value.data() + value.size(), threadCount);
+	if (std::make_error_condition(r.ec) || r.ptr != value.data() + value.size() || threadCount <= 0) {
+		throw std::runtime_error("Invalid thread count");
+	}
+	return threadCount;
+}
+
+
+static int parseStatesPerDepth(const std::string_view & value)
+{
+	int statesPerDepth = 0;
+	const std::from_chars_result r = std::from_chars(value.data(), value.data() + value.size(), statesPerDepth);
+	if (std::make_error_condition(r.ec) || r.ptr != value.data() + value.size() || statesPerDepth <= 0) {
+		throw std::runtime_error("Invalid states per depth");
+	}
+	return statesPerDepth;
+}
+
+
+static double parseWeight(const std::string_view & value)
+{
+	double weight = 0;
+	const std::from_chars_result r = std::from_chars(value.data(), value.data() + value.size(), weight);
+	if (std::make_error_condition(r.ec) || r.ptr != value.data() + value.size() || weight < 1) {
+		throw std::runtime_error("Invalid weight, expected at least 1");
+	}
+	return weight;
+}
+
+
+static Solver::Search parseSearch(const std::string_view & value)
+{
+	if (value == "bfs") return Solver::Search::Breadth;
+	if (value == "astar") return Solver::Search::AStar;
+	if (value == "beam") return Solver::Search::Beam;
+	if (value == "wastar") return Solver::Search::WeightedAStar;
+	if (value == "ida") return Solver::Search::IdaStar;
+	if (value == "hda") return Solver::Search::Distributed;
+	if (value == "frontier") return Solver::Search::Frontier;
+	throw std::runtime_error("Unknown search, expected bfs, astar, beam, wastar, ida, hda or frontier");
+}
+
+
 int main(int argc, char ** argv)
 {
-	if (argc != 2) {
-		throw std::runtime_error("Usage: slayawaycamp <level>");
+	static constexpr const char * kUsage = "Usage: slayawaycamp [-j <threads>] [-s bfs|astar|beam|wastar|ida|hda|frontier] "
+			"[-k <states per depth>] [-w <weight>] [-g] [-H <header>] <level>";
+
+	std::string_view name;
+	int threadCount = 1;
+	Solver::Search search = Solver::Search::Breadth;
+	int statesPerDepth = Solver::Config().statesPerDepth;
+	double weight = Solver::Config().weight;
+	bool genericPlayer = false;
+	std::filesystem::path levelHeaderPath;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		if (arg == "-j") {
+			if (++i == argc) {
+				throw std::runtime_error(kUsage);
+			}
+			threadCount = parseThreadCount(argv[i]);
+			continue;
+		}
+		if (arg == "-s") {
+			if (++i == argc) {
+				throw std::runtime_error(kUsage);
+			}
+			search = parseSearch(argv[i]);
+			continue;
+		}
+		if (arg == "-k") {
+			if (++i == argc) {
+				throw std::runtime_error(kUsage);
+			}
+			statesPerDepth = parseStatesPerDepth(argv[i]);
+			continue;
+		}
+		if (arg == "-w") {
+			if (++i == argc) {
+				throw std::runtime_error(kUsage);
+			}
+			weight = parseWeight(argv[i]);
+			continue;
+		}
+		if (arg == "-g") {
+			genericPlayer = true;
+			continue;
+		}
+		if (arg == "-H") {
+			if (++i == argc) {
+				throw std::runtime_error(kUsage);
+			}
+			levelHeaderPath = argv[i];
+			continue;
+		}
+		if (!name.empty()) {
+			throw std::runtime_error(kUsage);
+		}
+		name = arg;
+	}
+
+	if (name.empty()) {
+		throw std::runtime_error(kUsage);
 	}
 
-	App::Args args = getArgs(argv[1]);
+	App::Args args = getArgs(name);
+	args.solverConfig.threadCount = threadCount;
+	args.solverConfig.search = search;
+	args.solverConfig.statesPerDepth = statesPerDepth;
+	args.solverConfig.weight = weight;
+	args.solverConfig.genericPlayer = genericPlayer;
+	args.levelHeaderPath = levelHeaderPath;
 
 	App app(std::move(args));
 
@@ -0,0 +1,55 @@
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "Corpus.hpp"
+#include "Loader.hpp"
+#include "Solver.hpp"
+
+
+
+
+int main()
+{
+	// solves every level of the movies breadth-first and with A*, counting the heap allocations the solver makes
+	// while it plays states, which have to be none
+
+	const std::vector<std::filesystem::path> paths = corpusPaths(SLAYAWAYCAMP_MOVIES_DIR);
+
+	const Loader loader;
+
+	int64_t totalExpandedCount = 0;
+	int64_t totalAllocationCount = 0;
+	int allocatingCount = 0;
+
+	for (const std::filesystem::path & path : paths) {
+		const Map map = loader.load(path);
+
+		int64_t expandedCount = 0;
+		int64_t allocationCount = 0;
+		for (const Solver::Search search : {Solver::Search::Breadth, Solver::Search::AStar}) {
+			const Solver::Stats stats = Solver::solve(map, Solver::Config {
+				.search = search,
+				.allocationCount = threadAllocationCount,
+			}, [] (Solver::Solution &&) {});
+			expandedCount += stats.expandedCount;
+			allocationCount += stats.playAllocationCount;
+		}
+
+		if (allocationCount != 0) {
+			allocatingCount++;
+		}
+
+		printf("allocs: %s expanded: %lld allocations: %lld\n", path.filename().c_str(), (long long)expandedCount,
+				(long long)allocationCount);
+
+		totalExpandedCount += expandedCount;
+		totalAllocationCount += allocationCount;
+	}
+
+	printf("allocs: total levels: %d expanded: %lld allocations: %lld\n", int(paths.size()),
+			(long long)totalExpandedCount, (long long)totalAllocationCount);
+
+	return allocatingCount == 0 ? 0 : 1;
+}
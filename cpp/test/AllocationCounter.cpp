@@ -0,0 +1,88 @@
+#include "AllocationCounter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+
+
+
+static thread_local int64_t allocationCount = 0;
+
+
+
+
+int64_t threadAllocationCount() noexcept
+{
+	return allocationCount;
+}
+
+
+static void * allocate(const std::size_t size) noexcept
+{
+	allocationCount++;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+
+static void * allocateAligned(const std::size_t size, const std::align_val_t alignment) noexcept
+{
+	allocationCount++;
+	const std::size_t align = std::size_t(alignment);
+	// aligned_alloc wants a size that is a multiple of the alignment
+	return std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+}
+
+
+void * operator new(const std::size_t size)
+{
+	void * const p = allocate(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+
+void * operator new[](const std::size_t size)
+{
+	void * const p = allocate(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+
+void * operator new(const std::size_t size, const std::nothrow_t &) noexcept
+{
+	return allocate(size);
+}
+
+
+void * operator new[](const std::size_t size, const std::nothrow_t &) noexcept
+{
+	return allocate(size);
+}
+
+
+void * operator new(const std::size_t size, const std::align_val_t alignment)
+{
+	void * const p = allocateAligned(size, alignment);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+
+void * operator new[](const std::size_t size, const std::align_val_t alignment)
+{
+	void * const p = allocateAligned(size, alignment);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+
+void operator delete(void * const p) noexcept { std::free(p); }
+void operator delete[](void * const p) noexcept { std::free(p); }
+void operator delete(void * const p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void * const p, std::size_t) noexcept { std::free(p); }
+void operator delete(void * const p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void * const p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void * const p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void * const p, std::size_t, std::align_val_t) noexcept { std::free(p); }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+
+
+
+// Heap allocations made so far by the calling thread, counted by the replaced global operator new.
+int64_t threadAllocationCount() noexcept;
@@ -0,0 +1,223 @@
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "Corpus.hpp"
+#include "Loader.hpp"
+#include "Player.hpp"
+#include "ReferencePlayer.hpp"
+
+
+
+
+static std::string_view nameForResult(const Player::Result result) noexcept
+{
+	switch (result) {
+	case Player::Result::None: return "none";
+	case Player::Result::Fail: return "fail";
+	case Player::Result::Win:  return "win";
+	}
+	return "?";
+}
+
+
+// What a player made of a step; the state of a failed step is whatever the player left behind, so it does not count.
+struct StepOutcome {
+	Player::Result result = Player::Result::None;
+	State state {};
+
+	bool operator==(const StepOutcome & other) const noexcept
+	{
+		return result == other.result && (result == Player::Result::Fail || state == other.state);
+	}
+};
+
+
+// draws the state a variant diverged from and what the reference and the variant made of the step
+static void drawDivergence(const Loader & loader, const Map & map, const std::string_view & variant, const State & state,
+		const Dir dir, const StepOutcome & expected, const StepOutcome & actual)
+{
+	Map shown = map;
+	printf("check: %s: %s diverges playing %s from:\n", map.info.shortName.c_str(), variant.data(),
+			nameForDir(dir).data());
+	shown.state = state;
+	loader.draw(shown);
+
+	printf("check: reference: %s\n", nameForResult(expected.result).data());
+	shown.state = expected.state;
+	loader.draw(shown);
+
+	printf("check: %s: %s\n", variant.data(), nameForResult(actual.result).data());
+	shown.state = actual.state;
+	loader.draw(shown);
+}
+
+
+// Plays every direction from every state with the reference player, and with the player stepping a fresh state
+// and applying in place the way the solver does, one working state per state with every direction undone in turn.
+// Stops at the first divergence, which is drawn.
+template <typename PlayerType>
+static bool checkStates(const Loader & loader, const Map & map, const std::vector<State> & states,
+		int64_t & stepCount)
+{
+	WorkingState working;
+	UndoLog undoLog;
+
+	for (const State & state : states) {
+		working.load(state);
+
+		for (const Dir dir : kAllDirs) {
+			StepOutcome expected {.state = state};
+			expected.result = ReferencePlayer::play(map, expected.state, dir);
+
+			StepOutcome played {.state = state};
+			played.result = PlayerType::play(map, played.state, dir);
+
+			// in place, then undone
+			StepOutcome applied;
+			StepOutcome undone {.result = Player::Result::None};
+			const StepOutcome unchanged {.result = Player::Result::None, .state = state};
+			applied.result = PlayerType::apply(map, working, dir, undoLog);
+			working.commit(applied.state);
+			PlayerType::undo(working, undoLog);
+			working.commit(undone.state);
+
+			stepCount++;
+
+			if (!(played == expected)) {
+				drawDivergence(loader, map, "play", state, dir, expected, played);
+				return false;
+			}
+			if (!(applied == expected)) {
+				drawDivergence(loader, map, "apply", state, dir, expected, applied);
+				return false;
+			}
+			if (!(undone == unchanged)) {
+				drawDivergence(loader, map, "undo", state, dir, unchanged, undone);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// Walks random directions from the start, keeping one working state that is never undone, so that whatever it
+// caches has to follow a long line of steps. A walk ends at its first fail or win.
+template <typename PlayerType>
+static bool checkWalks(const Loader & loader, const Map & map, std::mt19937 & random, int64_t & stepCount)
+{
+	static constexpr int kWalkCount = 64;
+	static constexpr int kWalkLength = 256;
+
+	UndoLog undoLog;
+
+	for (int walk = 0; walk < kWalkCount; ++walk) {
+		State reference = map.state;
+		WorkingState working(map.state);
+
+		for (int step = 0; step < kWalkLength; ++step) {
+			const Dir dir = Dir(random() % kAllDirs.size());
+			const State state = reference;
+
+			StepOutcome expected;
+			expected.result = ReferencePlayer::play(map, reference, dir);
+			expected.state = reference;
+
+			StepOutcome walked;
+			walked.result = PlayerType::apply(map, working, dir, undoLog);
+			working.commit(walked.state);
+
+			stepCount++;
+
+			if (!(walked == expected)) {
+				drawDivergence(loader, map, "walk", state, dir, expected, walked);
+				return false;
+			}
+			if (expected.result != Player::Result::None) {
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+int main()
+{
+	// plays every reachable state of the movies and the samples, and random walks through them, with the reference
+	// player and with every other one: the generic player, the one specialized for the level and, in a binary
+	// built for a level, the one compiled for it
+
+	std::vector<std::filesystem::path> paths = corpusPaths(SLAYAWAYCAMP_MOVIES_DIR);
+	for (std::filesystem::path & path : corpusPaths(SLAYAWAYCAMP_SAMPLES_DIR)) {
+		paths.push_back(std::move(path));
+	}
+
+	const Loader loader;
+
+	// the same walks on every run
+	std::mt19937 random(1);
+
+	int levelCount = 0;
+	int64_t totalStepCount = 0;
+	int64_t totalWalkStepCount = 0;
+	int mismatchCount = 0;
+
+	for (const std::filesystem::path & path : paths) {
+		for (const Map & map : loader.loadAll(path)) {
+			const std::vector<State> states = [&map] () -> std::vector<State> {
+				const std::unordered_set<State> states = reachableStates<ReferencePlayer>(map, map.state);
+
+				// in a stable order, so that a divergence shows on the same state every run
+				std::vector<State> sorted(states.begin(), states.end());
+				std::sort(sorted.begin(), sorted.end(), [] (const State & a, const State & b) { return a.key < b.key; });
+				return sorted;
+			}();
+
+			int64_t stepCount = 0;
+			int64_t walkStepCount = 0;
+
+			bool same = checkStates<Player>(loader, map, states, stepCount) &&
+					checkWalks<Player>(loader, map, random, walkStepCount);
+
+			withPlayerMechanics(map.mechanics, [&] <uint16_t kMechanics> () {
+				if (same && kMechanics != Mechanics::kAll) {
+					same = checkStates<BasicPlayer<kMechanics>>(loader, map, states, stepCount) &&
+							checkWalks<BasicPlayer<kMechanics>>(loader, map, random, walkStepCount);
+				}
+			});
+
+#ifdef SLAYAWAYCAMP_LEVEL_HEADER
+			// and the player compiled for the level, in a binary built for it
+			if (same && FixedMap<GeneratedLevel>::matches(map)) {
+				printf("check: %s with the player of %s\n", map.info.shortName.c_str(), GeneratedLevel::kShortName.data());
+				same = checkStates<LevelPlayer>(loader, map, states, stepCount) &&
+						checkWalks<LevelPlayer>(loader, map, random, walkStepCount);
+			}
+#endif
+
+			if (!same) {
+				mismatchCount++;
+			}
+
+			printf("check: %s: %s mechanics: %03x steps: %lld walk steps: %lld%s\n", path.filename().c_str(),
+					map.info.shortName.c_str(), map.mechanics, (long long)stepCount, (long long)walkStepCount,
+					same ? "" : " MISMATCH");
+
+			levelCount++;
+			totalStepCount += stepCount;
+			totalWalkStepCount += walkStepCount;
+		}
+	}
+
+	printf("check: total levels: %d steps: %lld walk steps: %lld mismatches: %d\n", levelCount,
+			(long long)totalStepCount, (long long)totalWalkStepCount, mismatchCount);
+
+	return mismatchCount == 0 ? 0 : 1;
+}
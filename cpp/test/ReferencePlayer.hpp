@@ -0,0 +1,96 @@
+
+#pragma once
+
+#include <functional>
+#include <queue>
+
+#include "Player.hpp"
+
+
+
+
+// The player as it stood before any optimization, frozen for the checks to hold every other player to.
+// It reads the walls, phones, traps, teleports and gums of the map directly, none of the indices built from them,
+// and only changes when the rules of the game do.
+class ReferencePlayer {
+public:
+	using Result = Player::Result;
+
+	static Result play(const Map & map, State & state, Dir dir);
+
+private:
+	enum class Bump {
+		Wall,
+		Dude,
+		Drop,
+		Phone,
+		Death,
+		Portal,
+		Gum,
+	};
+
+	struct Res {
+		Bump bump;
+		Pos pos;
+		Pos target;
+		std::array<Teleport, kMaxTeleportCount> teleports;
+	};
+
+	struct Extra {
+		struct Dropped {
+			Dude drop;
+			Dir dir;
+		};
+		struct Scared {
+			Dude dude;
+			Dir dir;
+		};
+		struct Called {
+			Dude dude;
+			Dir dir;
+		};
+		enum class Fail {
+			None, Catality, Escaped, Cop, Swat, Drop
+		};
+		enum class Win {
+			None, Switch
+		};
+		std::queue<Dude> killed;
+		std::queue<Dropped> dropped;
+		std::queue<Scared> scared;
+		std::queue<Called> called;
+		Fail fail = Fail::None;
+		Win win = Win::None;
+	};
+
+	ReferencePlayer(const Map & map, State & state);
+
+	Result _step(Dir dir);
+
+	bool _aimedByCop(const Dude & cop) const noexcept;
+	bool _aimedByAnyCop() const noexcept;
+	bool _aimedBySwat(const Dude & swat) const noexcept;
+	bool _aimedByAnySwat() const noexcept;
+
+	void _trySwitchLight(const Wall & wall, Dir dir, Extra & extra) noexcept;
+	Res _go(const Pos & fromPos, Dir dir, bool portal) noexcept;
+	void _scare(const Pos & pos, Extra & extra) const noexcept;
+	void _call(const Dude & who, const Phone & phone, Extra & extra) const noexcept;
+	void _goDude(Dude dude, Dir dir, bool called, Extra & extra) noexcept;
+	void _kill(Dude dude, Extra & extra, std::queue<Extra::Scared> & scared) noexcept;
+	void _processExtra(Extra & extra) noexcept;
+
+	// the lookups the map made when this player was written
+	const Wall * _findWall(const Pos & pos, Dir dir) const noexcept;
+	bool _hasAnyWall(const Pos & pos, Dir dir) const noexcept;
+	bool _hasTallWall(const Pos & pos, Dir dir) const noexcept;
+	const Wall & _getWall(const Pos & pos, Dir dir) const noexcept;
+	std::vector<Phone>::const_iterator _findPhone(const Pos & pos) const noexcept;
+	const Phone & _getPhone(const Pos & pos) const noexcept;
+	std::vector<Gum>::const_iterator _findGum(const Pos & pos) const noexcept;
+	const Teleport & _getOtherTeleport(const Teleport & teleport) const noexcept;
+
+	const Map & map_;
+
+	State & state_;
+};